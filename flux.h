@@ -28,18 +28,29 @@
 #include <wlr/types/wlr_compositor.h>
 #include <wlr/types/wlr_cursor.h>
 #include <wlr/types/wlr_cursor_shape_v1.h>
+#include <wlr/types/wlr_commit_timing_v1.h>
 #include <wlr/types/wlr_data_device.h>
+#include <wlr/types/wlr_ext_foreign_toplevel_list_v1.h>
+#include <wlr/types/wlr_ext_image_capture_source_v1.h>
+#include <wlr/types/wlr_ext_image_copy_capture_v1.h>
+#include <wlr/types/wlr_fifo_v1.h>
 #include <wlr/types/wlr_fractional_scale_v1.h>
+#include <wlr/types/wlr_idle_inhibit_v1.h>
+#include <wlr/types/wlr_idle_notify_v1.h>
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_input_method_v2.h>
 #include <wlr/types/wlr_keyboard.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_presentation_time.h>
 #include <wlr/types/wlr_primary_selection_v1.h>
+#include <wlr/types/wlr_relative_pointer_v1.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_single_pixel_buffer_v1.h>
 #include <wlr/types/wlr_subcompositor.h>
+#include <wlr/types/wlr_tearing_control_v1.h>
 #include <wlr/types/wlr_text_input_v3.h>
 #include <wlr/types/wlr_viewporter.h>
 #include <wlr/types/wlr_xcursor_manager.h>
@@ -66,15 +77,167 @@ extern const float COLOR_TASKBAR_TEXT[4];
 extern const float COLOR_CURSOR_BLACK[4];
 extern const float COLOR_CURSOR_WHITE[4];
 
+#define FLUX_FRAME_STATS_WINDOW 512
+/* Millisecond knobs set to "auto" adapt to measured timings. */
+#define FLUX_MSEC_AUTO (-1)
+
 struct flux_server;
+struct flux_wallpaper;
+struct wallpaper_image;
 struct flux_view;
+struct flux_damage_debug;
+struct flux_hud;
+struct flux_soft_compositor;
+struct flux_spatial_index;
+
+/* Software compositor kernels; pixels are premultiplied ARGB8888. */
+struct soft_kernels {
+	const char *name;
+	void (*fill)(uint32_t *dst, size_t stride, int width, int height,
+		uint32_t color, bool blend);
+	void (*copy)(uint32_t *dst, size_t dst_stride, const uint32_t *src,
+		size_t src_stride, int width, int height, uint32_t or_mask);
+	void (*blend)(uint32_t *dst, size_t dst_stride, const uint32_t *src,
+		size_t src_stride, int width, int height);
+};
+
+enum flux_spatial_layer {
+	FLUX_SPATIAL_FRAMES,
+	FLUX_SPATIAL_TASKBAR,
+	FLUX_SPATIAL_LAYERS,
+};
+
+/* Grid cells a view currently occupies in one spatial index layer. */
+struct flux_spatial_slot {
+	bool indexed;
+	uint32_t generation;
+	int col0;
+	int row0;
+	int col1;
+	int row1;
+};
+
+enum flux_render_profile {
+	FLUX_RENDER_PROFILE_AUTO,
+	FLUX_RENDER_PROFILE_FULL,
+	FLUX_RENDER_PROFILE_LOW_POWER,
+};
+
+enum flux_scanout_result {
+	FLUX_SCANOUT_USED,
+	FLUX_SCANOUT_NO_FULLSCREEN,
+	FLUX_SCANOUT_VIEW_HIDDEN,
+	FLUX_SCANOUT_GEOMETRY,
+	FLUX_SCANOUT_OVERLAY,
+	FLUX_SCANOUT_REJECTED,
+	FLUX_SCANOUT_RESULT_COUNT,
+};
+
+enum flux_mode_policy {
+	FLUX_MODE_PREFERRED,
+	FLUX_MODE_HIGHEST_REFRESH,
+	FLUX_MODE_LOW_POWER,
+	FLUX_MODE_EXPLICIT,
+};
+
+struct flux_mode_request {
+	enum flux_mode_policy policy;
+	int32_t width;
+	int32_t height;
+	int32_t refresh_mhz;
+};
+
+enum flux_cursor_path {
+	FLUX_CURSOR_PATH_NONE, // not repainted yet
+	FLUX_CURSOR_PATH_SCENE,
+	FLUX_CURSOR_PATH_PLANE,
+	FLUX_CURSOR_PATH_SOFTWARE,
+};
+
+enum flux_vrr_mode {
+	FLUX_VRR_OFF,
+	FLUX_VRR_ON,
+	FLUX_VRR_AUTO,
+};
+
+/* Rolling window of frame timings, in microseconds. */
+struct flux_frame_histogram {
+	uint32_t samples_usec[FLUX_FRAME_STATS_WINDOW];
+	size_t count;
+	size_t next;
+	uint32_t max_usec;
+};
+
+struct flux_frame_stats {
+	struct flux_frame_histogram callback;
+	struct flux_frame_histogram commit;
+	struct flux_frame_histogram interval;
+	struct flux_frame_histogram mirror_copy;
+	uint64_t last_frame_nsec;
+	bool last_frame_committed;
+	uint64_t missed_refresh;
+};
 
 struct flux_output {
 	struct wl_list link;
 	struct flux_server *server;
 	struct wlr_output *wlr_output;
 	struct wlr_scene_rect *background_rect;
+	struct wlr_scene_buffer *wallpaper_node;
+	struct wallpaper_image *wallpaper_image;
+	struct wlr_scene_tree *taskbar_tree;
+	struct wlr_scene_rect *taskbar_bg_rect;
+	struct wlr_scene_tree *taskbar_buttons_tree;
+	struct wlr_box taskbar_box;
+	uint64_t taskbar_signature;
+	bool taskbar_dirty;
+	uint64_t taskbar_rebuilds;
+	struct flux_damage_debug *damage_debug;
+	struct flux_hud *hud;
+	uint64_t frames_rendered;
+	uint64_t frames_failed; // commits the backend rejected
+	uint64_t frames_skipped;
+	uint64_t frames_solid_only;
+	uint64_t frames_soft;
+	uint64_t soft_fallbacks;
+	uint64_t soft_verify_mismatches;
+	struct wlr_swapchain *soft_verify_swapchain;
+	struct flux_frame_stats stats;
+	uint64_t last_present_nsec;
+	uint64_t present_refresh_nsec;
+	uint32_t present_flags;
+	struct flux_mode_request mode_request;
+	char mirror_of[64];
+	struct wlr_buffer *mirror_buffer;
+	bool mirror_cursor_locked; // software cursor so mirrors show the pointer
+	enum flux_vrr_mode vrr_mode;
+	bool vrr_requested;
+	int max_render_time_msec;
+	uint64_t render_ewma_nsec;
+	uint64_t frames_delayed;
+	uint64_t frame_cap_nsec;
+	uint64_t last_commit_nsec;
+	uint64_t frames_capped;
+	/* Pointer moved on this output since its last repaint, and repaints it moved without compositing. */
+	bool cursor_moved;
+	uint64_t cursor_frames_avoided;
+	enum flux_cursor_path cursor_path;
+	uint64_t animation_frames_saved;
+	int frame_done_delay_msec;
+	uint64_t frames_done_deferred;
+	struct wl_event_source *frame_done_timer;
+	uint64_t frames_async;
+	uint64_t frames_vsync;
+	uint64_t async_fallbacks;
+	bool last_frame_async;
+	bool repaint_pending;
+	bool idle_off; // powered off by idle, back on at the next input
+	struct wl_event_source *repaint_timer;
+	struct flux_view *fullscreen_view;
+	uint64_t scanout_counts[FLUX_SCANOUT_RESULT_COUNT];
+	enum flux_scanout_result last_scanout_result;
 	struct wl_listener frame;
+	struct wl_listener present;
 	struct wl_listener destroy;
 };
 
@@ -107,6 +270,7 @@ struct flux_view {
 	float anim_to_scale;
 	float anim_from_alpha;
 	float anim_to_alpha;
+	struct wlr_box anim_current_box;
 	int x;
 	int y;
 	int width;
@@ -123,6 +287,23 @@ struct flux_view {
 	int taskbar_width;
 	int taskbar_height;
 	bool taskbar_visible;
+	uint32_t last_commit_msec;
+	uint32_t rapid_commit_count;
+	uint64_t frame_done_nsec;
+	uint64_t client_render_ewma_nsec;
+	bool frame_done_opt_out;
+	struct wlr_ext_foreign_toplevel_handle_v1 *foreign_toplevel;
+	struct wlr_scene *capture_scene;
+	struct wlr_ext_image_capture_source_v1 *capture_source;
+	bool fullscreen;
+	struct flux_output *fullscreen_output;
+	int saved_x;
+	int saved_y;
+	int saved_width;
+	int saved_height;
+	/* Higher is closer to the top; matches the order of server->views. */
+	uint64_t stack_seq;
+	struct flux_spatial_slot spatial[FLUX_SPATIAL_LAYERS];
 
 	struct wlr_scene_tree *frame_tree;
 	struct wlr_scene_tree *content_tree;
@@ -131,6 +312,7 @@ struct flux_view {
 	struct wlr_scene_rect *right_border_rect;
 	struct wlr_scene_rect *bottom_border_rect;
 	struct wlr_scene_rect *minimize_rect;
+	struct wl_list subsurfaces; // flux_view_subsurface::link, low-power profile only
 
 	struct wl_listener map;
 	struct wl_listener unmap;
@@ -140,6 +322,8 @@ struct flux_view {
 	struct wl_listener set_app_id;
 	struct wl_listener request_move;
 	struct wl_listener request_resize;
+	struct wl_listener request_fullscreen;
+	struct wl_listener new_subsurface;
 };
 
 enum flux_cursor_mode {
@@ -162,13 +346,27 @@ struct flux_server {
 	struct wlr_viewporter *viewporter;
 	struct wlr_fractional_scale_manager_v1 *fractional_scale_v1;
 	struct wlr_cursor_shape_manager_v1 *cursor_shape_v1;
+	struct wlr_relative_pointer_manager_v1 *relative_pointer_v1;
 	struct wlr_xcursor_manager *xcursor_manager;
 	struct wlr_text_input_manager_v3 *text_input_v3;
 	struct wlr_input_method_manager_v2 *input_method_v2;
 	struct wlr_xdg_decoration_manager_v1 *xdg_decoration_v1;
-	struct wlr_scene_tree *taskbar_tree;
-	struct wlr_scene_rect *taskbar_bg_rect;
-	struct wlr_scene_tree *taskbar_buttons_tree;
+	struct wlr_presentation *presentation;
+	struct wlr_idle_notifier_v1 *idle_notifier;
+	struct wlr_idle_inhibit_manager_v1 *idle_inhibit_manager;
+	struct wlr_tearing_control_manager_v1 *tearing_control_v1;
+	struct wlr_single_pixel_buffer_manager_v1 *single_pixel_buffer_v1;
+	struct wlr_ext_image_copy_capture_manager_v1 *image_copy_capture;
+	struct wlr_ext_output_image_capture_source_manager_v1 *output_capture_source;
+	struct wlr_ext_foreign_toplevel_list_v1 *foreign_toplevel_list;
+	struct wlr_ext_foreign_toplevel_image_capture_source_manager_v1 *toplevel_capture_source;
+	struct wlr_fifo_manager_v1 *fifo_manager;
+	struct wlr_commit_timing_manager_v1 *commit_timing_manager;
+	struct wl_list paced_surfaces; // flux_paced_surface::link
+	struct flux_wallpaper *wallpaper;
+	struct flux_soft_compositor *soft_compositor;
+	struct flux_spatial_index *spatial_index;
+	uint64_t view_stack_seq;
 	struct wlr_seat *seat;
 	struct wlr_cursor *cursor;
 
@@ -180,6 +378,14 @@ struct flux_server {
 	double cursor_y;
 	int cursor_hotspot_x;
 	int cursor_hotspot_y;
+	/* Motion since the last hit-test; applied once per output frame. */
+	bool coalesce_motion;
+	bool motion_pending;
+	uint32_t motion_time_msec;
+	struct wlr_output *motion_output; // under the pointer at the last wakeup
+	struct wlr_surface *motion_focus;
+	double motion_focus_lx;
+	double motion_focus_ly;
 	uint32_t keybind_mod_mask;
 	enum flux_cursor_mode cursor_mode;
 	struct flux_view *grabbed_view;
@@ -195,8 +401,21 @@ struct flux_server {
 	double grab_y;
 
 	struct wlr_scene_tree *cursor_tree;
+	/* Custom cursor goes through wlr_cursor (cursor plane) instead of cursor_tree. */
+	bool cursor_plane;
+	bool cursor_image_set;
+	struct wlr_buffer *drawn_cursor_buffer;
+	float drawn_cursor_pixel_scale;
+	struct wlr_scene_tree *damage_overlay_tree;
+	bool damage_debug;
+	struct wlr_scene_tree *hud_tree;
+	struct wl_event_source *hud_timer;
+	bool hud_enabled;
+	uint64_t input_events;
+	uint64_t client_commits;
 
 	struct wl_listener new_output;
+	struct wl_listener output_layout_change;
 	struct wl_listener new_input;
 	struct wl_listener new_xdg_toplevel;
 	struct wl_listener cursor_motion;
@@ -208,20 +427,29 @@ struct flux_server {
 	struct wl_listener cursor_shape_request_set_shape;
 	struct wl_listener xdg_activation_request_activate;
 	struct wl_listener xdg_decoration_new_toplevel;
+	struct wl_listener new_idle_inhibitor;
+	struct wl_listener new_fifo;
+	struct wl_listener new_commit_timer;
+	struct wl_listener capture_toplevel_request;
 
 	struct wl_event_source *sigint_source;
 	struct wl_event_source *sigterm_source;
+	struct wl_event_source *sigusr1_source;
 
 	bool suppress_button_until_release;
 	bool interactive_grab_from_client;
 	int next_view_x;
 	int next_view_y;
-	int taskbar_layout_x;
-	int taskbar_layout_y;
-	int taskbar_layout_width;
-	int taskbar_layout_height;
-	bool taskbar_dirty;
+	bool animations_running;
 	bool use_drawn_cursor;
+	enum flux_render_profile render_profile;
+
+	struct wl_event_source *idle_timer;
+	uint32_t idle_timeout_msec;
+	uint64_t idle_last_activity_nsec;
+	int idle_inhibitor_count;
+	bool idle_timer_armed;
+	bool outputs_idle_off;
 };
 
 /* theme.c */
@@ -230,6 +458,7 @@ struct flux_server {
 void init_logging(void);
 void close_logging(void);
 const char *flux_log_path(void);
+void create_parent_dirs(const char *path);
 void flux_log_callback(enum wlr_log_importance importance, const char *fmt, va_list args);
 int handle_terminate_signal(int signal_number, void *data);
 void setup_child_reaping(void);
@@ -237,6 +466,16 @@ void setup_child_reaping(void);
 /* config.c */
 int env_int(const char *name, int fallback);
 uint32_t parse_keybind_mod_mask(void);
+bool env_output_value(const char *list_name, const char *global_name,
+	const char *output_name, char *out, size_t out_len);
+enum flux_vrr_mode parse_vrr_mode(const char *output_name);
+int parse_max_render_time(const char *output_name);
+int parse_frame_done_delay(const char *output_name);
+enum flux_render_profile parse_render_profile(void);
+int parse_low_power_fps(const char *output_name);
+bool env_list_contains(const char *list_name, const char *item);
+void parse_output_mode(const char *output_name, struct flux_mode_request *out);
+bool parse_mirror_source(const char *output_name, char *out, size_t out_len);
 
 /* launch.c */
 const char *default_launch_command(void);
@@ -253,15 +492,36 @@ void view_set_visible(struct flux_view *view, bool visible);
 void view_begin_minimize_animation(struct flux_view *view, uint32_t time_msec);
 void view_begin_restore_animation(struct flux_view *view, uint32_t time_msec);
 bool view_tick_animations(struct flux_server *server, uint32_t time_msec);
+void view_schedule_animation_frames(struct flux_server *server,
+	struct flux_output *repainted);
+void view_set_fullscreen(struct flux_view *view, bool fullscreen,
+	struct wlr_output *requested);
+void view_note_commit(struct flux_view *view, uint32_t time_msec);
+bool view_is_actively_rendering(struct flux_view *view, uint32_t time_msec);
 void focus_view(struct flux_view *view, struct wlr_surface *surface);
 struct flux_view *view_at(struct flux_server *server, double lx, double ly,
 	struct wlr_surface **surface, double *sx, double *sy);
 struct flux_view *view_frame_at(struct flux_server *server, double lx, double ly);
 uint32_t view_resize_edges_at(struct flux_view *view, double lx, double ly);
+void view_raise_stack(struct flux_view *view);
+void view_index_update(struct flux_view *view);
+void view_index_remove(struct flux_view *view);
+void view_index_rebuild(struct flux_server *server);
 bool view_point_in_frame_border(struct flux_view *view, double lx, double ly);
 bool point_in_minimize_button(struct flux_view *view, double lx, double ly);
 bool point_in_titlebar_drag_region(struct flux_view *view, double lx, double ly);
 
+/* spatial_index.c */
+struct flux_spatial_index *spatial_index_create(void);
+void spatial_index_destroy(struct flux_spatial_index *index);
+void spatial_index_reset(struct flux_spatial_index *index, const struct wlr_box *bounds);
+void spatial_index_set(struct flux_spatial_index *index, enum flux_spatial_layer layer,
+	struct flux_view *view, const struct wlr_box *box);
+void spatial_index_restack(struct flux_spatial_index *index, struct flux_view *view);
+bool spatial_index_query(const struct flux_spatial_index *index,
+	enum flux_spatial_layer layer, double lx, double ly,
+	struct flux_view *const **views, size_t *count);
+
 /* cursor.c */
 void apply_default_cursor(struct flux_server *server);
 void cursor_shape_request_set_shape_notify(struct wl_listener *listener, void *data);
@@ -271,10 +531,97 @@ void cursor_motion_absolute_notify(struct wl_listener *listener, void *data);
 void cursor_button_notify(struct wl_listener *listener, void *data);
 void cursor_axis_notify(struct wl_listener *listener, void *data);
 void cursor_frame_notify(struct wl_listener *listener, void *data);
+void cursor_flush_motion(struct flux_server *server);
 void create_cursor_pointer(struct flux_server *server);
+void cursor_reload_custom(struct flux_server *server);
+void cursor_finish(struct flux_server *server);
 
 /* output.c */
 void new_output_notify(struct wl_listener *listener, void *data);
+void output_layout_change_notify(struct wl_listener *listener, void *data);
+const char *scanout_result_name(enum flux_scanout_result result);
+const char *cursor_path_name(enum flux_cursor_path path);
+bool output_apply_mode_request(struct flux_output *output,
+	const struct flux_mode_request *request);
+void output_toggle_refresh_policy(struct flux_server *server);
+bool output_set_power(struct flux_output *output, bool on);
+void output_set_background_enabled(struct flux_output *output, bool enabled);
+bool output_has_fixed_refresh(struct flux_output *output);
+uint64_t output_render_budget_nsec(struct flux_output *output);
+enum wlr_scale_filter_mode render_profile_scale_filter(struct flux_server *server);
+
+/* idle.c */
+bool idle_init(struct flux_server *server);
+void idle_notify_activity(struct flux_server *server);
+void idle_output_added(struct flux_output *output);
+
+/* mirror.c */
+bool output_is_mirror(const struct flux_output *output);
+void mirror_source_committed(struct flux_output *source, struct wlr_buffer *buffer);
+void mirror_release(struct flux_output *mirror);
+void mirror_update_cursors(struct flux_server *server);
+void mirror_repaint(struct flux_output *mirror);
+
+/* wallpaper.c */
+bool wallpaper_init(struct flux_server *server);
+void wallpaper_finish(struct flux_server *server);
+void wallpaper_output_update(struct flux_output *output);
+void wallpaper_output_destroy(struct flux_output *output);
+
+/* damage_debug.c */
+void damage_debug_init(struct flux_server *server);
+void damage_debug_toggle(struct flux_server *server);
+void damage_debug_tick(struct flux_output *output,
+	struct wlr_scene_output *scene_output, uint32_t now_msec);
+void damage_debug_output_destroy(struct flux_output *output);
+
+/* hud.c */
+bool hud_init(struct flux_server *server);
+void hud_toggle(struct flux_server *server);
+void hud_output_tick(struct flux_output *output, uint32_t now_msec);
+void hud_output_destroy(struct flux_output *output);
+
+/* soft_compositor.c */
+bool soft_compositor_init(struct flux_server *server);
+void soft_compositor_finish(struct flux_server *server);
+void soft_compositor_output_destroy(struct flux_output *output);
+bool soft_compositor_build_state(struct flux_output *output,
+	struct wlr_scene_output *scene_output, struct wlr_output_state *state);
+
+/* soft_kernels.c */
+const struct soft_kernels *soft_kernels_pixman(void);
+const struct soft_kernels *soft_kernels_best(void);
+
+/* frame_done.c */
+void frame_done_output_init(struct flux_output *output);
+void frame_done_output_finish(struct flux_output *output);
+void frame_done_send(struct flux_output *output, struct wlr_scene_output *scene_output,
+	uint64_t now_nsec);
+void frame_done_note_commit(struct flux_view *view, uint64_t now_nsec);
+void frame_done_update_opt_out(struct flux_view *view);
+
+/* capture.c */
+bool capture_init(struct flux_server *server);
+void capture_view_map(struct flux_view *view);
+void capture_view_unmap(struct flux_view *view);
+void capture_view_update(struct flux_view *view);
+void capture_view_destroy(struct flux_view *view);
+
+/* pacing.c */
+bool pacing_init(struct flux_server *server);
+void pacing_output_repaint(struct flux_output *output);
+void pacing_outputs_changed(struct flux_server *server);
+
+/* frame_stats.c */
+uint64_t timespec_to_nsec(const struct timespec *ts);
+uint64_t monotonic_nsec(void);
+uint64_t output_refresh_nsec(struct flux_output *output);
+uint64_t output_predict_present_nsec(struct flux_output *output, uint64_t now_nsec);
+void frame_histogram_record(struct flux_frame_histogram *hist, uint64_t nsec);
+void frame_stats_begin_frame(struct flux_output *output, uint64_t now_nsec);
+void frame_stats_log_output(struct flux_output *output);
+void frame_stats_dump(struct flux_server *server);
+int handle_frame_stats_signal(int signal_number, void *data);
 
 /* input.c */
 void new_input_notify(struct wl_listener *listener, void *data);
@@ -285,9 +632,16 @@ void xdg_decoration_new_toplevel_notify(struct wl_listener *listener, void *data
 void new_xdg_toplevel_notify(struct wl_listener *listener, void *data);
 
 /* taskbar.c */
-void taskbar_init(struct flux_server *server);
+int taskbar_bar_height(void);
+int taskbar_draw_text(struct wlr_scene_tree *parent, int x, int y,
+	const char *text, const float color[4]);
+int taskbar_text_width(const char *text);
+int taskbar_text_height(void);
+const uint8_t *taskbar_glyph_rows(char ch);
+void taskbar_output_init(struct flux_output *output);
+void taskbar_output_destroy(struct flux_output *output);
 void taskbar_mark_dirty(struct flux_server *server);
-void taskbar_update(struct flux_server *server);
+void taskbar_update_output(struct flux_output *output);
 struct flux_view *taskbar_view_at(struct flux_server *server, double lx, double ly);
 bool taskbar_predict_button_box(struct flux_server *server, struct flux_view *target,
 	bool include_target_if_not_minimized, struct wlr_box *out);
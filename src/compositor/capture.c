@@ -0,0 +1,125 @@
+#include "flux.h"
+
+#define IMAGE_COPY_CAPTURE_VERSION 1
+#define IMAGE_CAPTURE_SOURCE_VERSION 1
+#define FOREIGN_TOPLEVEL_LIST_VERSION 1
+
+/*
+ * Screen capture through ext-image-copy-capture-v1. Outputs use the wlroots
+ * output source. Each view gets a private scene holding only its surfaces, so
+ * a window can be captured while covered, off-screen or minimized. wlroots
+ * tracks damage per capture session and copies only the damaged regions into
+ * the client's buffer, through whichever renderer is active (pixman included).
+ */
+
+static void capture_view_state(struct flux_view *view,
+		struct wlr_ext_foreign_toplevel_handle_v1_state *state) {
+	struct wlr_xdg_toplevel *toplevel = view->xdg_surface->toplevel;
+	state->title = toplevel && toplevel->title ? toplevel->title : "";
+	state->app_id = toplevel && toplevel->app_id ? toplevel->app_id : "";
+}
+
+void capture_view_map(struct flux_view *view) {
+	struct flux_server *server = view->server;
+	if (!server->foreign_toplevel_list || view->foreign_toplevel) {
+		return;
+	}
+	struct wlr_ext_foreign_toplevel_handle_v1_state state;
+	capture_view_state(view, &state);
+	view->foreign_toplevel =
+		wlr_ext_foreign_toplevel_handle_v1_create(server->foreign_toplevel_list, &state);
+	if (view->foreign_toplevel) {
+		view->foreign_toplevel->data = view;
+	}
+}
+
+void capture_view_unmap(struct flux_view *view) {
+	if (view->foreign_toplevel) {
+		wlr_ext_foreign_toplevel_handle_v1_destroy(view->foreign_toplevel);
+		view->foreign_toplevel = NULL;
+	}
+}
+
+void capture_view_update(struct flux_view *view) {
+	if (!view->foreign_toplevel) {
+		return;
+	}
+	struct wlr_ext_foreign_toplevel_handle_v1_state state;
+	capture_view_state(view, &state);
+	wlr_ext_foreign_toplevel_handle_v1_update_state(view->foreign_toplevel, &state);
+}
+
+void capture_view_destroy(struct flux_view *view) {
+	capture_view_unmap(view);
+	/* Destroying the scene also tears down the capture source built on it. */
+	if (view->capture_scene) {
+		wlr_scene_node_destroy(&view->capture_scene->tree.node);
+		view->capture_scene = NULL;
+		view->capture_source = NULL;
+	}
+}
+
+static struct wlr_ext_image_capture_source_v1 *capture_view_source(struct flux_view *view) {
+	if (view->capture_source) {
+		return view->capture_source;
+	}
+
+	struct flux_server *server = view->server;
+	if (!view->capture_scene) {
+		view->capture_scene = wlr_scene_create();
+		if (!view->capture_scene) {
+			return NULL;
+		}
+		if (!wlr_scene_xdg_surface_create(&view->capture_scene->tree, view->xdg_surface)) {
+			wlr_scene_node_destroy(&view->capture_scene->tree.node);
+			view->capture_scene = NULL;
+			return NULL;
+		}
+	}
+	view->capture_source = wlr_ext_image_capture_source_v1_create_with_scene_node(
+		&view->capture_scene->tree.node, wl_display_get_event_loop(server->display),
+		server->allocator, server->renderer);
+	return view->capture_source;
+}
+
+static void capture_toplevel_request_notify(struct wl_listener *listener, void *data) {
+	struct flux_server *server =
+		wl_container_of(listener, server, capture_toplevel_request);
+	struct wlr_ext_foreign_toplevel_image_capture_source_manager_v1_request *request = data;
+	struct flux_view *view = request->toplevel_handle->data;
+	if (!view) {
+		return;
+	}
+
+	struct wlr_ext_image_capture_source_v1 *source = capture_view_source(view);
+	if (!source) {
+		wlr_log(WLR_ERROR, "capture: failed to create source for view %s",
+			view->xdg_surface->toplevel && view->xdg_surface->toplevel->app_id ?
+				view->xdg_surface->toplevel->app_id : "(null)");
+		return;
+	}
+	wlr_ext_foreign_toplevel_image_capture_source_manager_v1_request_accept(request, source);
+}
+
+bool capture_init(struct flux_server *server) {
+	struct wl_display *display = server->display;
+	server->image_copy_capture =
+		wlr_ext_image_copy_capture_manager_v1_create(display, IMAGE_COPY_CAPTURE_VERSION);
+	server->output_capture_source =
+		wlr_ext_output_image_capture_source_manager_v1_create(display,
+			IMAGE_CAPTURE_SOURCE_VERSION);
+	server->foreign_toplevel_list =
+		wlr_ext_foreign_toplevel_list_v1_create(display, FOREIGN_TOPLEVEL_LIST_VERSION);
+	server->toplevel_capture_source =
+		wlr_ext_foreign_toplevel_image_capture_source_manager_v1_create(display,
+			IMAGE_CAPTURE_SOURCE_VERSION);
+	if (!server->image_copy_capture || !server->output_capture_source ||
+			!server->foreign_toplevel_list || !server->toplevel_capture_source) {
+		return false;
+	}
+
+	server->capture_toplevel_request.notify = capture_toplevel_request_notify;
+	wl_signal_add(&server->toplevel_capture_source->events.new_request,
+		&server->capture_toplevel_request);
+	return true;
+}
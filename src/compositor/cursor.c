@@ -16,6 +16,11 @@ static void raise_cursor_to_top(struct flux_server *server) {
 	}
 }
 
+/* Flux's own pointer is up, either as scene nodes or handed to wlr_cursor. */
+static bool custom_cursor_shown(struct flux_server *server) {
+	return server->cursor_tree || server->cursor_image_set;
+}
+
 static void clamp_cursor_to_layout(struct flux_server *server) {
 	struct wlr_box box = {0};
 	wlr_output_layout_get_box(server->output_layout, NULL, &box);
@@ -53,7 +58,7 @@ static void enable_drawn_cursor_fallback(struct flux_server *server, const char
 
 	server->use_drawn_cursor = true;
 	wlr_cursor_unset_image(server->cursor);
-	if (!server->cursor_tree) {
+	if (!custom_cursor_shown(server)) {
 		create_cursor_pointer(server);
 	}
 }
@@ -126,7 +131,7 @@ void apply_default_cursor(struct flux_server *server) {
 	static bool theme_probe_ok = false;
 
 	if (server->use_drawn_cursor) {
-		if (!server->cursor_tree) {
+		if (!custom_cursor_shown(server)) {
 			wlr_cursor_unset_image(server->cursor);
 			create_cursor_pointer(server);
 		}
@@ -217,6 +222,8 @@ void seat_request_set_cursor_notify(struct wl_listener *listener, void *data) {
 }
 
 static void process_cursor_motion(struct flux_server *server, uint32_t time_msec) {
+	server->motion_pending = false;
+	server->motion_focus = NULL;
 	clamp_cursor_to_layout(server);
 
 	if (server->cursor_tree) {
@@ -233,6 +240,7 @@ static void process_cursor_motion(struct flux_server *server, uint32_t time_msec
 		server->grabbed_view->x = nx;
 		server->grabbed_view->y = ny;
 		wlr_scene_node_set_position(&server->grabbed_view->frame_tree->node, nx, ny);
+		view_index_update(server->grabbed_view);
 		return;
 	}
 
@@ -312,31 +320,127 @@ static void process_cursor_motion(struct flux_server *server, uint32_t time_msec
 	focus_view(view, surface);
 	wlr_seat_pointer_notify_enter(server->seat, surface, sx, sy);
 	wlr_seat_pointer_notify_motion(server->seat, time_msec, sx, sy);
+	server->motion_focus = surface;
+	server->motion_focus_lx = server->cursor_x - sx;
+	server->motion_focus_ly = server->cursor_y - sy;
+}
+
+/*
+ * Clients still see every motion event while the hit-test is deferred, as
+ * long as the pointer stays inside the surface found by the last one.
+ * Crossing its edge waits for the flush, which sends leave/enter.
+ */
+static void forward_motion_to_focus(struct flux_server *server, uint32_t time_msec) {
+	struct wlr_surface *focus = server->seat->pointer_state.focused_surface;
+	if (server->cursor_mode != CURSOR_PASSTHROUGH || !focus || focus != server->motion_focus) {
+		return;
+	}
+	double sx = server->cursor_x - server->motion_focus_lx;
+	double sy = server->cursor_y - server->motion_focus_ly;
+	if (sx < 0.0 || sy < 0.0 ||
+			sx >= focus->current.width || sy >= focus->current.height) {
+		return;
+	}
+	wlr_seat_pointer_notify_motion(server->seat, time_msec, sx, sy);
+}
+
+/*
+ * Wakes the output under the pointer, and on a boundary crossing the output
+ * being left as well, so other displays stay idle. Returns false when no
+ * powered output is under the pointer.
+ */
+static bool schedule_motion_frame(struct flux_server *server, struct wlr_output *under) {
+	struct wlr_output *left = server->motion_output;
+	server->motion_output = under;
+	if (left && left != under && left->enabled) {
+		wlr_output_schedule_frame(left);
+	}
+	if (!under || !under->enabled) {
+		return false;
+	}
+	wlr_output_schedule_frame(under);
+	return true;
+}
+
+/*
+ * Flags the output under the pointer, and the one it just left, so only
+ * their next repaints count as cursor-only frames.
+ */
+static void mark_motion_outputs(struct flux_server *server, struct wlr_output *under) {
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->wlr_output == under || output->wlr_output == server->motion_output) {
+			output->cursor_moved = true;
+		}
+	}
+}
+
+/*
+ * High-rate mice deliver several events per refresh. Only the cursor itself
+ * follows each one; the hit-test, focus and scene updates wait for the next
+ * output frame, or for a button or axis event that needs them current.
+ */
+static void queue_cursor_motion(struct flux_server *server, uint32_t time_msec) {
+	struct wlr_output *under = wlr_output_layout_output_at(server->output_layout,
+		server->cursor_x, server->cursor_y);
+	mark_motion_outputs(server, under);
+	if (!server->coalesce_motion) {
+		server->motion_output = under;
+		process_cursor_motion(server, time_msec);
+		return;
+	}
+	server->motion_time_msec = time_msec;
+	forward_motion_to_focus(server, time_msec);
+	if (server->motion_pending) {
+		/* A crossing mid-burst still wakes the output the pointer entered. */
+		if (under != server->motion_output) {
+			schedule_motion_frame(server, under);
+		}
+		return;
+	}
+	if (!schedule_motion_frame(server, under)) {
+		/* No powered output under the pointer would flush it; do it now. */
+		process_cursor_motion(server, time_msec);
+		return;
+	}
+	server->motion_pending = true;
+}
+
+void cursor_flush_motion(struct flux_server *server) {
+	if (server->motion_pending) {
+		process_cursor_motion(server, server->motion_time_msec);
+	}
 }
 
 void cursor_motion_notify(struct wl_listener *listener, void *data) {
 	struct flux_server *server = wl_container_of(listener, server, cursor_motion);
+	idle_notify_activity(server);
 	struct wlr_pointer_motion_event *event = data;
 
+	wlr_relative_pointer_manager_v1_send_relative_motion(server->relative_pointer_v1,
+		server->seat, (uint64_t)event->time_msec * 1000,
+		event->delta_x, event->delta_y, event->unaccel_dx, event->unaccel_dy);
 	wlr_cursor_move(server->cursor, &event->pointer->base,
 		event->delta_x, event->delta_y);
 	server->cursor_x = server->cursor->x;
 	server->cursor_y = server->cursor->y;
-	process_cursor_motion(server, event->time_msec);
+	queue_cursor_motion(server, event->time_msec);
 }
 
 void cursor_motion_absolute_notify(struct wl_listener *listener, void *data) {
 	struct flux_server *server = wl_container_of(listener, server, cursor_motion_absolute);
+	idle_notify_activity(server);
 	struct wlr_pointer_motion_absolute_event *event = data;
 
 	wlr_cursor_warp_absolute(server->cursor, &event->pointer->base, event->x, event->y);
 	server->cursor_x = server->cursor->x;
 	server->cursor_y = server->cursor->y;
-	process_cursor_motion(server, event->time_msec);
+	queue_cursor_motion(server, event->time_msec);
 }
 
 void cursor_button_notify(struct wl_listener *listener, void *data) {
 	struct flux_server *server = wl_container_of(listener, server, cursor_button);
+	idle_notify_activity(server);
 	struct wlr_pointer_button_event *event = data;
 
 	// Make sure pointer focus is up-to-date even when the user clicks without moving.
@@ -460,8 +564,11 @@ void cursor_button_notify(struct wl_listener *listener, void *data) {
 
 void cursor_axis_notify(struct wl_listener *listener, void *data) {
 	struct flux_server *server = wl_container_of(listener, server, cursor_axis);
+	idle_notify_activity(server);
 	struct wlr_pointer_axis_event *event = data;
 
+	/* Scroll goes to the surface under the pointer now, not the last hit-test. */
+	cursor_flush_motion(server);
 	wlr_seat_pointer_notify_axis(server->seat, event->time_msec,
 		event->orientation, event->delta, event->delta_discrete,
 		event->source, event->relative_direction);
@@ -833,6 +940,61 @@ struct cursor_segment {
 	int w;
 };
 
+/*
+ * Pixel cursor styled after mouse/mouse.png:
+ * white body + slate wedge + dark stem, with crisp black outline.
+ * Hotspot remains at (0,0).
+ */
+#define CURSOR_ART_SIZE 24
+/* Samples per axis when resampling the art to the cursor's pixel size. */
+#define CURSOR_AA_SAMPLES 4
+
+static const struct cursor_segment cursor_outline[] = {
+	{0, 0, 2},  {0, 1, 3},  {0, 2, 4},  {0, 3, 6},
+	{0, 4, 8},  {0, 5, 10}, {0, 6, 12}, {0, 7, 14},
+	{0, 8, 16}, {0, 9, 18}, {0, 10, 20}, {0, 11, 22},
+	{0, 12, 24}, {0, 13, 23}, {0, 14, 21}, {0, 15, 19},
+	{0, 16, 16}, {0, 17, 10}, {12, 17, 5}, {0, 18, 9},
+	{12, 18, 4}, {0, 19, 8}, {12, 19, 3}, {0, 20, 7},
+	{12, 20, 2}, {0, 21, 6}, {11, 21, 2}, {0, 22, 5},
+	{10, 22, 2}, {0, 23, 4}, {9, 23, 2},
+};
+static const struct cursor_segment cursor_white[] = {
+	{1, 1, 1},  {1, 2, 2},  {1, 3, 4},  {1, 4, 6},
+	{1, 5, 8},  {1, 6, 10}, {1, 7, 12}, {1, 8, 14},
+	{1, 9, 16}, {1, 10, 18}, {1, 11, 20}, {1, 12, 21},
+	{1, 13, 20}, {1, 14, 18}, {1, 15, 16}, {1, 16, 11},
+	{1, 17, 8}, {1, 18, 7}, {1, 19, 6}, {1, 20, 5},
+	{1, 21, 4}, {1, 22, 3},
+};
+static const struct cursor_segment cursor_shadow[] = {
+	{4, 4, 2},  {5, 5, 3},  {6, 6, 4},  {7, 7, 5},
+	{8, 8, 6},  {9, 9, 7},  {10, 10, 8}, {11, 11, 9},
+	{12, 12, 9}, {13, 13, 8}, {13, 14, 7}, {12, 15, 6},
+	{12, 16, 4},
+};
+static const struct cursor_segment cursor_stem[] = {
+	{12, 17, 4}, {12, 18, 4}, {12, 19, 3}, {12, 20, 2},
+	{11, 21, 2}, {10, 22, 2},
+};
+
+static const float COLOR_CURSOR_SHADOW[4] = {0.53f, 0.57f, 0.67f, 1.0f};
+static const float COLOR_CURSOR_STEM[4] = {0.22f, 0.24f, 0.31f, 1.0f};
+
+static float cursor_max_output_scale(struct flux_server *server) {
+	float max_output_scale = 1.0f;
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (!output->wlr_output) {
+			continue;
+		}
+		if (output->wlr_output->scale > max_output_scale) {
+			max_output_scale = output->wlr_output->scale;
+		}
+	}
+	return max_output_scale;
+}
+
 static float cursor_draw_scale(struct flux_server *server) {
 	const char *env = getenv("FLUX_CURSOR_DRAW_SCALE");
 	if (env && env[0] != '\0') {
@@ -848,153 +1010,267 @@ static float cursor_draw_scale(struct flux_server *server) {
 		}
 	}
 
-	float max_output_scale = 1.0f;
-	struct flux_output *output;
-	wl_list_for_each(output, &server->outputs, link) {
-		if (!output->wlr_output) {
-			continue;
-		}
-		if (output->wlr_output->scale > max_output_scale) {
-			max_output_scale = output->wlr_output->scale;
-		}
-	}
-
 	/* Keep cursor roughly physical-size stable on HiDPI outputs. */
+	float max_output_scale = cursor_max_output_scale(server);
 	if (max_output_scale > 1.0f) {
 		return 1.0f / max_output_scale;
 	}
 	return 1.0f;
 }
 
-static void draw_cursor_segments(struct wlr_scene_tree *tree,
-		const struct cursor_segment *segments, size_t count,
-		const float color[4], float scale) {
-	for (size_t i = 0; i < count; i++) {
-		if (segments[i].w <= 0) {
-			continue;
-		}
+static uint32_t premultiplied_argb(const float color[4]) {
+	float a = color[3];
+	return ((uint32_t)lroundf(a * 255.0f) << 24) |
+		((uint32_t)lroundf(color[0] * a * 255.0f) << 16) |
+		((uint32_t)lroundf(color[1] * a * 255.0f) << 8) |
+		(uint32_t)lroundf(color[2] * a * 255.0f);
+}
 
-		int x = (int)lroundf((float)segments[i].x * scale);
-		int y = (int)lroundf((float)segments[i].y * scale);
-		int w = (int)lroundf((float)segments[i].w * scale);
-		if (w < 1) {
-			w = 1;
+static void paint_cursor_segments(uint32_t art[CURSOR_ART_SIZE][CURSOR_ART_SIZE],
+		const struct cursor_segment *segments, size_t count, const float color[4]) {
+	uint32_t pixel = premultiplied_argb(color);
+	for (size_t i = 0; i < count; i++) {
+		const struct cursor_segment *seg = &segments[i];
+		for (int x = seg->x; x < seg->x + seg->w && x < CURSOR_ART_SIZE; x++) {
+			art[seg->y][x] = pixel;
 		}
-
-		struct wlr_scene_rect *r =
-			wlr_scene_rect_create(tree, w, 1, color);
-		wlr_scene_node_set_position(&r->node, x, y);
 	}
 }
 
-void create_cursor_pointer(struct flux_server *server) {
-	server->cursor_tree = wlr_scene_tree_create(&server->scene->tree);
-	wlr_scene_node_set_position(&server->cursor_tree->node, 0, 0);
-	wlr_scene_node_raise_to_top(&server->cursor_tree->node);
-	float draw_scale = cursor_draw_scale(server);
+/*
+ * Rasterizes the arrow once into a premultiplied ARGB buffer of
+ * ceil(CURSOR_ART_SIZE * pixel_scale) pixels. Each pixel averages a
+ * CURSOR_AA_SAMPLES^2 grid of art samples, which keeps the art exact at 1x
+ * and gives smooth edges at fractional scales, where per-row rects used to
+ * round to uneven steps.
+ */
+static struct flux_cursor_file_buffer *rasterize_drawn_cursor(float pixel_scale) {
+	uint32_t art[CURSOR_ART_SIZE][CURSOR_ART_SIZE] = {{0}};
+	paint_cursor_segments(art, cursor_outline,
+		sizeof(cursor_outline) / sizeof(cursor_outline[0]), COLOR_CURSOR_BLACK);
+	paint_cursor_segments(art, cursor_white,
+		sizeof(cursor_white) / sizeof(cursor_white[0]), COLOR_CURSOR_WHITE);
+	paint_cursor_segments(art, cursor_shadow,
+		sizeof(cursor_shadow) / sizeof(cursor_shadow[0]), COLOR_CURSOR_SHADOW);
+	paint_cursor_segments(art, cursor_stem,
+		sizeof(cursor_stem) / sizeof(cursor_stem[0]), COLOR_CURSOR_STEM);
+
+	int size = (int)ceilf((float)CURSOR_ART_SIZE * pixel_scale);
+	struct flux_cursor_file_buffer *buffer = cursor_file_buffer_create(size, size);
+	if (!buffer) {
+		return NULL;
+	}
 
-	bool use_image_cursor = env_int("FLUX_CURSOR_IMAGE", 1) != 0;
-	if (use_image_cursor) {
-		char cursor_path[PATH_MAX];
-		if (resolve_cursor_image_path(cursor_path)) {
-			int hotspot_x = 0;
-			int hotspot_y = 0;
-			struct flux_cursor_file_buffer *cursor_buffer =
-				load_cursor_png_buffer(cursor_path, &hotspot_x, &hotspot_y);
-			if (cursor_buffer) {
-				struct wlr_scene_buffer *scene_buffer =
-					wlr_scene_buffer_create(server->cursor_tree, &cursor_buffer->base);
-				if (scene_buffer) {
-					int src_w = cursor_buffer->base.width;
-					int src_h = cursor_buffer->base.height;
-					int dst_w = (int)lroundf((float)src_w * draw_scale);
-					int dst_h = (int)lroundf((float)src_h * draw_scale);
-					if (dst_w < 1) {
-						dst_w = 1;
+	const int samples = CURSOR_AA_SAMPLES * CURSOR_AA_SAMPLES;
+	for (int y = 0; y < size; y++) {
+		uint32_t *row = buffer->data + (size_t)y * (size_t)size;
+		for (int x = 0; x < size; x++) {
+			uint32_t sum[4] = {0};
+			for (int sy = 0; sy < CURSOR_AA_SAMPLES; sy++) {
+				int v = (int)(((float)y + ((float)sy + 0.5f) / CURSOR_AA_SAMPLES) / pixel_scale);
+				for (int sx = 0; sx < CURSOR_AA_SAMPLES; sx++) {
+					int u = (int)(((float)x + ((float)sx + 0.5f) / CURSOR_AA_SAMPLES) /
+						pixel_scale);
+					if (u >= CURSOR_ART_SIZE || v >= CURSOR_ART_SIZE) {
+						continue;
 					}
-					if (dst_h < 1) {
-						dst_h = 1;
+					uint32_t px = art[v][u];
+					for (int c = 0; c < 4; c++) {
+						sum[c] += (px >> (c * 8)) & 0xff;
 					}
-
-					if (dst_w != src_w || dst_h != src_h) {
-						wlr_scene_buffer_set_dest_size(scene_buffer, dst_w, dst_h);
-						wlr_log(WLR_INFO,
-							"image cursor scale=%.2f src=%dx%d dst=%dx%d",
-							draw_scale, src_w, src_h, dst_w, dst_h);
-					}
-
-					float sx = (float)dst_w / (float)src_w;
-					float sy = (float)dst_h / (float)src_h;
-					/*
-					 * Always use detected hotspot for image cursors. This avoids
-					 * stale env overrides from shifting click targets far away.
-					 */
-					server->cursor_hotspot_x = (int)lroundf((float)hotspot_x * sx);
-					server->cursor_hotspot_y = (int)lroundf((float)hotspot_y * sy);
-					wlr_log(WLR_INFO, "using image cursor hotspot=%d,%d",
-						server->cursor_hotspot_x, server->cursor_hotspot_y);
-					wlr_buffer_drop(&cursor_buffer->base);
-					return;
 				}
-				wlr_log(WLR_ERROR, "failed to create scene buffer for cursor image %s",
-					cursor_path);
-				wlr_buffer_drop(&cursor_buffer->base);
-			} else {
-				wlr_log(WLR_ERROR, "failed to decode cursor image %s; using drawn pointer",
-					cursor_path);
 			}
-		} else {
-			wlr_log(WLR_INFO,
-				"FLUX_CURSOR_IMAGE=1 but mouse/mouse.png was not found; using drawn pointer");
+			uint32_t out = 0;
+			for (int c = 0; c < 4; c++) {
+				out |= ((sum[c] + samples / 2) / samples) << (c * 8);
+			}
+			row[x] = out;
 		}
 	}
+	return buffer;
+}
+
+/*
+ * The arrow only changes with its pixel scale, so it is drawn once and kept
+ * across output hotplug; every rebuild of the cursor tree reuses it.
+ */
+static struct wlr_buffer *drawn_cursor_buffer(struct flux_server *server, float pixel_scale) {
+	if (server->drawn_cursor_buffer && server->drawn_cursor_pixel_scale == pixel_scale) {
+		return server->drawn_cursor_buffer;
+	}
+	struct flux_cursor_file_buffer *buffer = rasterize_drawn_cursor(pixel_scale);
+	if (!buffer) {
+		return NULL;
+	}
+	if (server->drawn_cursor_buffer) {
+		wlr_buffer_drop(server->drawn_cursor_buffer);
+	}
+	server->drawn_cursor_buffer = &buffer->base;
+	server->drawn_cursor_pixel_scale = pixel_scale;
+	wlr_log(WLR_INFO, "drawn cursor rasterized at %dx%d", buffer->base.width,
+		buffer->base.height);
+	return server->drawn_cursor_buffer;
+}
+
+void cursor_finish(struct flux_server *server) {
+	if (server->drawn_cursor_buffer) {
+		wlr_buffer_drop(server->drawn_cursor_buffer);
+		server->drawn_cursor_buffer = NULL;
+	}
+}
+
+/*
+ * Decodes mouse/mouse.png and sets the hotspot from it. Returns a locked
+ * buffer and its logical size, or NULL when the drawn arrow should be used.
+ */
+static struct wlr_buffer *load_image_cursor(struct flux_server *server, float draw_scale,
+		int *width, int *height) {
+	char cursor_path[PATH_MAX];
+	if (!resolve_cursor_image_path(cursor_path)) {
+		wlr_log(WLR_INFO,
+			"FLUX_CURSOR_IMAGE=1 but mouse/mouse.png was not found; using drawn pointer");
+		return NULL;
+	}
+	int hotspot_x = 0;
+	int hotspot_y = 0;
+	struct flux_cursor_file_buffer *cursor_buffer =
+		load_cursor_png_buffer(cursor_path, &hotspot_x, &hotspot_y);
+	if (!cursor_buffer) {
+		wlr_log(WLR_ERROR, "failed to decode cursor image %s; using drawn pointer",
+			cursor_path);
+		return NULL;
+	}
+
+	int src_w = cursor_buffer->base.width;
+	int src_h = cursor_buffer->base.height;
+	int dst_w = (int)lroundf((float)src_w * draw_scale);
+	int dst_h = (int)lroundf((float)src_h * draw_scale);
+	if (dst_w < 1) {
+		dst_w = 1;
+	}
+	if (dst_h < 1) {
+		dst_h = 1;
+	}
+	if (dst_w != src_w || dst_h != src_h) {
+		wlr_log(WLR_INFO, "image cursor scale=%.2f src=%dx%d dst=%dx%d",
+			draw_scale, src_w, src_h, dst_w, dst_h);
+	}
 
+	float sx = (float)dst_w / (float)src_w;
+	float sy = (float)dst_h / (float)src_h;
 	/*
-	 * Pixel cursor styled after mouse/mouse.png:
-	 * white body + slate wedge + dark stem, with crisp black outline.
-	 * Hotspot remains at (0,0).
+	 * Always use detected hotspot for image cursors. This avoids
+	 * stale env overrides from shifting click targets far away.
 	 */
-	static const struct cursor_segment outline[] = {
-		{0, 0, 2},  {0, 1, 3},  {0, 2, 4},  {0, 3, 6},
-		{0, 4, 8},  {0, 5, 10}, {0, 6, 12}, {0, 7, 14},
-		{0, 8, 16}, {0, 9, 18}, {0, 10, 20}, {0, 11, 22},
-		{0, 12, 24}, {0, 13, 23}, {0, 14, 21}, {0, 15, 19},
-		{0, 16, 16}, {0, 17, 10}, {12, 17, 5}, {0, 18, 9},
-		{12, 18, 4}, {0, 19, 8}, {12, 19, 3}, {0, 20, 7},
-		{12, 20, 2}, {0, 21, 6}, {11, 21, 2}, {0, 22, 5},
-		{10, 22, 2}, {0, 23, 4}, {9, 23, 2},
-	};
-	static const struct cursor_segment white[] = {
-		{1, 1, 1},  {1, 2, 2},  {1, 3, 4},  {1, 4, 6},
-		{1, 5, 8},  {1, 6, 10}, {1, 7, 12}, {1, 8, 14},
-		{1, 9, 16}, {1, 10, 18}, {1, 11, 20}, {1, 12, 21},
-		{1, 13, 20}, {1, 14, 18}, {1, 15, 16}, {1, 16, 11},
-		{1, 17, 8}, {1, 18, 7}, {1, 19, 6}, {1, 20, 5},
-		{1, 21, 4}, {1, 22, 3},
-	};
-	static const struct cursor_segment shadow[] = {
-		{4, 4, 2},  {5, 5, 3},  {6, 6, 4},  {7, 7, 5},
-		{8, 8, 6},  {9, 9, 7},  {10, 10, 8}, {11, 11, 9},
-		{12, 12, 9}, {13, 13, 8}, {13, 14, 7}, {12, 15, 6},
-		{12, 16, 4},
-	};
-	static const struct cursor_segment stem[] = {
-		{12, 17, 4}, {12, 18, 4}, {12, 19, 3}, {12, 20, 2},
-		{11, 21, 2}, {10, 22, 2},
-	};
+	server->cursor_hotspot_x = (int)lroundf((float)hotspot_x * sx);
+	server->cursor_hotspot_y = (int)lroundf((float)hotspot_y * sy);
+	wlr_log(WLR_INFO, "using image cursor hotspot=%d,%d",
+		server->cursor_hotspot_x, server->cursor_hotspot_y);
+
+	/* Trade the creator reference for a lock so the caller just unlocks. */
+	struct wlr_buffer *buffer = wlr_buffer_lock(&cursor_buffer->base);
+	wlr_buffer_drop(&cursor_buffer->base);
+	*width = dst_w;
+	*height = dst_h;
+	return buffer;
+}
 
-	static const float cursor_shadow[4] = {0.53f, 0.57f, 0.67f, 1.0f};
-	static const float cursor_stem[4] = {0.22f, 0.24f, 0.31f, 1.0f};
+static struct wlr_buffer *load_drawn_cursor(struct flux_server *server, float draw_scale,
+		int *width, int *height) {
 	if (draw_scale != 1.0f) {
 		wlr_log(WLR_INFO, "drawn cursor scale=%.2f", draw_scale);
 	}
 
-	draw_cursor_segments(server->cursor_tree,
-		outline, sizeof(outline) / sizeof(outline[0]), COLOR_CURSOR_BLACK, draw_scale);
-	draw_cursor_segments(server->cursor_tree,
-		white, sizeof(white) / sizeof(white[0]), COLOR_CURSOR_WHITE, draw_scale);
-	draw_cursor_segments(server->cursor_tree,
-		shadow, sizeof(shadow) / sizeof(shadow[0]), cursor_shadow, draw_scale);
-	draw_cursor_segments(server->cursor_tree,
-		stem, sizeof(stem) / sizeof(stem[0]), cursor_stem, draw_scale);
+	/* Rasterize at output resolution so HiDPI outputs get a sharp arrow. */
+	float pixel_scale = draw_scale * cursor_max_output_scale(server);
+	struct wlr_buffer *buffer = drawn_cursor_buffer(server, pixel_scale);
+	if (!buffer) {
+		wlr_log(WLR_ERROR, "failed to rasterize the drawn cursor");
+		return NULL;
+	}
+	*width = (int)ceilf((float)CURSOR_ART_SIZE * draw_scale);
+	*height = *width;
+	return wlr_buffer_lock(buffer);
+}
+
+/*
+ * wlr_cursor puts the buffer on each output's cursor plane when the backend
+ * has one and draws it in software otherwise, so pointer motion no longer
+ * damages the scene. Hotspot and scale are in buffer pixels.
+ */
+static void show_cursor_on_plane(struct flux_server *server, struct wlr_buffer *buffer,
+		int width) {
+	float scale = (float)buffer->width / (float)width;
+	wlr_cursor_set_buffer(server->cursor, buffer,
+		(int32_t)lroundf((float)server->cursor_hotspot_x * scale),
+		(int32_t)lroundf((float)server->cursor_hotspot_y * scale), scale);
+	server->cursor_image_set = true;
+}
+
+static void show_cursor_in_scene(struct flux_server *server, struct wlr_buffer *buffer,
+		int width, int height) {
+	server->cursor_tree = wlr_scene_tree_create(&server->scene->tree);
+	if (!server->cursor_tree) {
+		wlr_log(WLR_ERROR, "failed to create the cursor scene tree");
+		return;
+	}
+	wlr_scene_node_set_position(&server->cursor_tree->node, 0, 0);
+	wlr_scene_node_raise_to_top(&server->cursor_tree->node);
+
+	struct wlr_scene_buffer *scene_buffer =
+		wlr_scene_buffer_create(server->cursor_tree, buffer);
+	if (!scene_buffer) {
+		wlr_log(WLR_ERROR, "failed to create scene buffer for the cursor");
+		return;
+	}
+	if (width != buffer->width || height != buffer->height) {
+		wlr_scene_buffer_set_dest_size(scene_buffer, width, height);
+	}
+	wlr_scene_buffer_set_filter_mode(scene_buffer, render_profile_scale_filter(server));
+}
+
+void create_cursor_pointer(struct flux_server *server) {
+	float draw_scale = cursor_draw_scale(server);
+	int width = 0;
+	int height = 0;
+	struct wlr_buffer *buffer = NULL;
+	if (env_int("FLUX_CURSOR_IMAGE", 1) != 0) {
+		buffer = load_image_cursor(server, draw_scale, &width, &height);
+	}
+	if (!buffer) {
+		buffer = load_drawn_cursor(server, draw_scale, &width, &height);
+	}
+	if (!buffer) {
+		return;
+	}
+
+	if (server->cursor_plane) {
+		show_cursor_on_plane(server, buffer, width);
+	} else {
+		show_cursor_in_scene(server, buffer, width, height);
+	}
+	wlr_log(WLR_INFO, "custom cursor %dx%d via %s", width, height,
+		server->cursor_plane ? "wlr_cursor (cursor plane)" : "scene nodes");
+	wlr_buffer_unlock(buffer);
+}
+
+/*
+ * Rebuilds the custom pointer for new output scales, or after cursor_plane
+ * changed, dropping whichever form it was shown in.
+ */
+void cursor_reload_custom(struct flux_server *server) {
+	if (server->cursor_tree) {
+		wlr_scene_node_destroy(&server->cursor_tree->node);
+		server->cursor_tree = NULL;
+	}
+	if (server->cursor_image_set && !server->cursor_plane) {
+		wlr_cursor_unset_image(server->cursor);
+	}
+	server->cursor_image_set = false;
+	create_cursor_pointer(server);
+	if (server->cursor_tree) {
+		wlr_scene_node_set_position(&server->cursor_tree->node,
+			(int)server->cursor_x - server->cursor_hotspot_x,
+			(int)server->cursor_y - server->cursor_hotspot_y);
+	}
 }
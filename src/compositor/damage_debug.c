@@ -0,0 +1,254 @@
+#include "flux.h"
+
+#include <pixman.h>
+#include <wlr/util/region.h>
+
+#define DAMAGE_DEBUG_FADE_MSEC 400
+#define DAMAGE_DEBUG_ALPHA 0.35f
+/* Past this many rects a frame is drawn as its bounding box. */
+#define DAMAGE_DEBUG_MAX_RECTS 64
+#define DAMAGE_DEBUG_LABEL_PAD 3
+
+static const float DAMAGE_DEBUG_PALETTE[][3] = {
+	{1.0f, 0.2f, 0.2f},
+	{0.2f, 1.0f, 0.2f},
+	{0.2f, 0.4f, 1.0f},
+	{1.0f, 1.0f, 0.2f},
+	{1.0f, 0.2f, 1.0f},
+	{0.2f, 1.0f, 1.0f},
+};
+static const float COLOR_DAMAGE_LABEL_BG[4] = {0.0f, 0.0f, 0.0f, 1.0f};
+static const float COLOR_DAMAGE_LABEL_TEXT[4] = {1.0f, 1.0f, 0.2f, 1.0f};
+
+struct flux_damage_mark {
+	struct wl_list link;
+	struct wlr_scene_rect *rect;
+	float rgb[3];
+	uint32_t born_msec;
+};
+
+struct flux_damage_debug {
+	struct wl_list marks; // flux_damage_mark::link
+	struct wlr_scene_tree *label_tree;
+	struct wlr_box label_box;
+	bool label_shown;
+	uint64_t shown_pixels;
+	uint64_t last_pixels;
+	uint32_t frame_seq;
+};
+
+static void mark_box(struct flux_damage_mark *mark, struct wlr_box *box) {
+	box->x = mark->rect->node.x;
+	box->y = mark->rect->node.y;
+	box->width = mark->rect->width;
+	box->height = mark->rect->height;
+}
+
+static void mark_set_alpha(struct flux_damage_mark *mark, float alpha) {
+	/* Scene rect colours are premultiplied. */
+	const float color[4] = {
+		mark->rgb[0] * alpha, mark->rgb[1] * alpha, mark->rgb[2] * alpha, alpha,
+	};
+	wlr_scene_rect_set_color(mark->rect, color);
+}
+
+static void mark_destroy(struct flux_damage_mark *mark) {
+	wlr_scene_node_destroy(&mark->rect->node);
+	wl_list_remove(&mark->link);
+	free(mark);
+}
+
+static void output_debug_clear(struct flux_output *output) {
+	struct flux_damage_debug *debug = output->damage_debug;
+	if (!debug) {
+		return;
+	}
+	struct flux_damage_mark *mark, *tmp;
+	wl_list_for_each_safe(mark, tmp, &debug->marks, link) {
+		mark_destroy(mark);
+	}
+	if (debug->label_tree) {
+		wlr_scene_node_destroy(&debug->label_tree->node);
+	}
+	free(debug);
+	output->damage_debug = NULL;
+}
+
+static struct flux_damage_debug *output_debug_ensure(struct flux_output *output) {
+	if (output->damage_debug) {
+		return output->damage_debug;
+	}
+	struct flux_damage_debug *debug = calloc(1, sizeof(*debug));
+	if (!debug) {
+		return NULL;
+	}
+	wl_list_init(&debug->marks);
+	output->damage_debug = debug;
+	return debug;
+}
+
+static void update_label(struct flux_output *output, struct flux_damage_debug *debug) {
+	struct flux_server *server = output->server;
+	if (debug->label_shown && debug->shown_pixels == debug->last_pixels) {
+		return;
+	}
+	struct wlr_box box;
+	wlr_output_layout_get_box(server->output_layout, output->wlr_output, &box);
+	if (box.width <= 0 || box.height <= 0) {
+		return;
+	}
+
+	if (debug->label_tree) {
+		wlr_scene_node_destroy(&debug->label_tree->node);
+	}
+	debug->label_tree = wlr_scene_tree_create(server->damage_overlay_tree);
+	if (!debug->label_tree) {
+		debug->label_shown = false;
+		return;
+	}
+
+	char text[48];
+	snprintf(text, sizeof(text), "DMG %llu PX", (unsigned long long)debug->last_pixels);
+	int text_w = taskbar_text_width(text);
+	int text_h = taskbar_text_height();
+	int bar_h = taskbar_bar_height();
+	debug->label_box.width = text_w + DAMAGE_DEBUG_LABEL_PAD * 2;
+	debug->label_box.height = text_h + DAMAGE_DEBUG_LABEL_PAD * 2;
+	debug->label_box.x = box.x + box.width - debug->label_box.width - DAMAGE_DEBUG_LABEL_PAD;
+	debug->label_box.y = box.y + box.height - bar_h + (bar_h - debug->label_box.height) / 2;
+
+	wlr_scene_node_set_position(&debug->label_tree->node,
+		debug->label_box.x, debug->label_box.y);
+	wlr_scene_rect_create(debug->label_tree, debug->label_box.width,
+		debug->label_box.height, COLOR_DAMAGE_LABEL_BG);
+	taskbar_draw_text(debug->label_tree, DAMAGE_DEBUG_LABEL_PAD, DAMAGE_DEBUG_LABEL_PAD,
+		text, COLOR_DAMAGE_LABEL_TEXT);
+	debug->shown_pixels = debug->last_pixels;
+	debug->label_shown = true;
+}
+
+void damage_debug_init(struct flux_server *server) {
+	server->damage_overlay_tree = wlr_scene_tree_create(&server->scene->tree);
+	server->damage_debug = env_int("FLUX_DEBUG_DAMAGE", 0) != 0;
+	if (server->damage_debug) {
+		wlr_log(WLR_INFO, "damage debug overlay enabled");
+	}
+}
+
+void damage_debug_toggle(struct flux_server *server) {
+	if (!server->damage_overlay_tree) {
+		return;
+	}
+	server->damage_debug = !server->damage_debug;
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		output_debug_clear(output);
+		wlr_output_schedule_frame(output->wlr_output);
+	}
+	wlr_log(WLR_INFO, "damage debug overlay %s", server->damage_debug ? "on" : "off");
+}
+
+/*
+ * Marks the scene damage pending for this frame. It runs before the overlay
+ * changes anything, so the damage is exactly what the rest of the scene
+ * changed since the last commit; the overlay's own fading never shows up.
+ */
+static void record_damage(struct flux_output *output, struct flux_damage_debug *debug,
+		const pixman_region32_t *pending, uint32_t now_msec) {
+	struct flux_server *server = output->server;
+	struct wlr_output *wlr_output = output->wlr_output;
+	struct wlr_box box;
+	wlr_output_layout_get_box(server->output_layout, wlr_output, &box);
+	if (box.width <= 0 || box.height <= 0 || !pixman_region32_not_empty(pending)) {
+		return;
+	}
+
+	int nrects = 0;
+	const pixman_box32_t *rects = pixman_region32_rectangles(pending, &nrects);
+	uint64_t pixels = 0;
+	for (int i = 0; i < nrects; i++) {
+		pixels += (uint64_t)(rects[i].x2 - rects[i].x1) * (uint64_t)(rects[i].y2 - rects[i].y1);
+	}
+	debug->last_pixels = pixels;
+
+	/* Buffer damage -> logical output space -> layout space. */
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	wlr_region_transform(&damage, pending,
+		wlr_output_transform_invert(wlr_output->transform),
+		wlr_output->width, wlr_output->height);
+	float scale = wlr_output->scale > 0.0f ? wlr_output->scale : 1.0f;
+	wlr_region_scale(&damage, &damage, 1.0f / scale);
+	pixman_region32_translate(&damage, box.x, box.y);
+	pixman_region32_intersect_rect(&damage, &damage,
+		box.x, box.y, (unsigned)box.width, (unsigned)box.height);
+
+	rects = pixman_region32_rectangles(&damage, &nrects);
+	if (nrects > DAMAGE_DEBUG_MAX_RECTS) {
+		rects = pixman_region32_extents(&damage);
+		nrects = 1;
+	}
+	const float *rgb = DAMAGE_DEBUG_PALETTE[debug->frame_seq++ %
+		(sizeof(DAMAGE_DEBUG_PALETTE) / sizeof(DAMAGE_DEBUG_PALETTE[0]))];
+	for (int i = 0; i < nrects; i++) {
+		struct flux_damage_mark *mark = calloc(1, sizeof(*mark));
+		if (!mark) {
+			break;
+		}
+		memcpy(mark->rgb, rgb, sizeof(mark->rgb));
+		const float color[4] = {0};
+		mark->rect = wlr_scene_rect_create(server->damage_overlay_tree,
+			rects[i].x2 - rects[i].x1, rects[i].y2 - rects[i].y1, color);
+		if (!mark->rect) {
+			free(mark);
+			break;
+		}
+		wlr_scene_node_set_position(&mark->rect->node, rects[i].x1, rects[i].y1);
+		mark_set_alpha(mark, DAMAGE_DEBUG_ALPHA);
+		mark->born_msec = now_msec;
+		wl_list_insert(&debug->marks, &mark->link);
+	}
+	pixman_region32_fini(&damage);
+}
+
+void damage_debug_tick(struct flux_output *output,
+		struct wlr_scene_output *scene_output, uint32_t now_msec) {
+	struct flux_server *server = output->server;
+	if (!server->damage_debug) {
+		return;
+	}
+	struct flux_damage_debug *debug = output_debug_ensure(output);
+	if (!debug) {
+		return;
+	}
+
+	pixman_region32_t pending;
+	pixman_region32_init(&pending);
+	pixman_region32_copy(&pending, &scene_output->pending_commit_damage);
+
+	struct flux_damage_mark *mark, *tmp;
+	wl_list_for_each_safe(mark, tmp, &debug->marks, link) {
+		uint32_t age = now_msec - mark->born_msec;
+		if (age >= DAMAGE_DEBUG_FADE_MSEC) {
+			mark_destroy(mark);
+			continue;
+		}
+		mark_set_alpha(mark, DAMAGE_DEBUG_ALPHA *
+			(1.0f - (float)age / (float)DAMAGE_DEBUG_FADE_MSEC));
+	}
+	record_damage(output, debug, &pending, now_msec);
+	pixman_region32_fini(&pending);
+	update_label(output, debug);
+
+	wlr_scene_node_raise_to_top(&server->damage_overlay_tree->node);
+	if (server->cursor_tree) {
+		wlr_scene_node_raise_to_top(&server->cursor_tree->node);
+	}
+	if (!wl_list_empty(&debug->marks)) {
+		wlr_output_schedule_frame(output->wlr_output);
+	}
+}
+
+void damage_debug_output_destroy(struct flux_output *output) {
+	output_debug_clear(output);
+}
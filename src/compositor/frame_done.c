@@ -0,0 +1,198 @@
+#include "flux.h"
+
+/* Headroom on top of a client's measured render time. */
+#define CLIENT_RENDER_SLACK_NSEC 2000000ull
+/* Commits this long after frame-done were not rendered in response to it. */
+#define CLIENT_RENDER_MAX_SAMPLE_NSEC 100000000ull
+
+enum frame_done_pass {
+	FRAME_DONE_PASS_IMMEDIATE,
+	FRAME_DONE_PASS_DEFERRED,
+};
+
+struct frame_done_iter {
+	struct flux_output *output;
+	struct wlr_scene_output *scene_output;
+	enum frame_done_pass pass;
+	struct timespec when;
+	uint64_t when_nsec;
+	uint64_t client_budget_nsec;
+	bool any_deferred;
+};
+
+/* Subsurfaces and popups take the timing of the toplevel they belong to. */
+static struct flux_view *view_owning_surface(struct flux_server *server,
+		struct wlr_surface *surface) {
+	struct wlr_surface *root = wlr_surface_get_root_surface(surface);
+	struct wlr_xdg_surface *xdg_surface = wlr_xdg_surface_try_from_wlr_surface(root);
+	while (xdg_surface && xdg_surface->role == WLR_XDG_SURFACE_ROLE_POPUP &&
+			xdg_surface->popup && xdg_surface->popup->parent) {
+		root = wlr_surface_get_root_surface(xdg_surface->popup->parent);
+		xdg_surface = wlr_xdg_surface_try_from_wlr_surface(root);
+	}
+	return view_from_surface(server, root);
+}
+
+/* Views are only deferred once we know how long they take to draw. */
+static bool view_defers_frame_done(const struct flux_view *view) {
+	return view && !view->frame_done_opt_out && view->client_render_ewma_nsec > 0;
+}
+
+static void frame_done_iter_buffer(struct wlr_scene_buffer *buffer, int sx, int sy,
+		void *data) {
+	(void)sx;
+	(void)sy;
+	struct frame_done_iter *iter = data;
+	struct wlr_scene_surface *scene_surface = wlr_scene_surface_try_from_buffer(buffer);
+	if (!scene_surface || buffer->primary_output != iter->scene_output) {
+		return;
+	}
+
+	struct wlr_surface *surface = scene_surface->surface;
+	struct flux_view *view = view_owning_surface(iter->output->server, surface);
+	bool deferred = view_defers_frame_done(view);
+	if (iter->pass == FRAME_DONE_PASS_IMMEDIATE && deferred) {
+		uint64_t budget = view->client_render_ewma_nsec + CLIENT_RENDER_SLACK_NSEC;
+		if (budget > iter->client_budget_nsec) {
+			iter->client_budget_nsec = budget;
+		}
+		iter->any_deferred = true;
+		return;
+	}
+	if (iter->pass == FRAME_DONE_PASS_DEFERRED && !deferred) {
+		return;
+	}
+
+	if (view && !wl_list_empty(&surface->current.frame_callback_list)) {
+		view->frame_done_nsec = iter->when_nsec;
+	}
+	wlr_surface_send_frame_done(surface, &iter->when);
+}
+
+static void frame_done_run(struct flux_output *output, struct wlr_scene_output *scene_output,
+		struct frame_done_iter *iter, enum frame_done_pass pass, uint64_t now_nsec) {
+	iter->output = output;
+	iter->scene_output = scene_output;
+	iter->pass = pass;
+	iter->when_nsec = now_nsec;
+	iter->when.tv_sec = (time_t)(now_nsec / 1000000000ull);
+	iter->when.tv_nsec = (long)(now_nsec % 1000000000ull);
+	wlr_scene_output_for_each_buffer(scene_output, frame_done_iter_buffer, iter);
+}
+
+static int frame_done_timer_notify(void *data) {
+	struct flux_output *output = data;
+	struct wlr_scene_output *scene_output =
+		wlr_scene_get_scene_output(output->server->scene, output->wlr_output);
+	if (scene_output && output->wlr_output->enabled) {
+		struct frame_done_iter iter = {0};
+		frame_done_run(output, scene_output, &iter, FRAME_DONE_PASS_DEFERRED,
+			monotonic_nsec());
+	}
+	return 0;
+}
+
+/*
+ * Nanoseconds from now until deferred views should get frame-done: late enough
+ * that they sample fresh input, early enough that their commit still makes the
+ * next composite. Returns 0 when they should get it straight away.
+ */
+static uint64_t frame_done_delay_nsec(struct flux_output *output, uint64_t now_nsec,
+		uint64_t client_budget_nsec) {
+	uint64_t refresh = output_refresh_nsec(output);
+	if (refresh == 0 || output->last_present_nsec == 0 ||
+			!output_has_fixed_refresh(output)) {
+		return 0;
+	}
+	if (output->frame_done_delay_msec > 0) {
+		uint64_t configured = (uint64_t)output->frame_done_delay_msec * 1000000ull;
+		if (configured > client_budget_nsec) {
+			client_budget_nsec = configured;
+		}
+	}
+
+	/*
+	 * The next composite starts on the next frame event, or, with a render
+	 * deadline, one refresh later minus the render budget.
+	 */
+	uint64_t next_composite = output_predict_present_nsec(output, now_nsec);
+	uint64_t render_budget = output_render_budget_nsec(output);
+	if (render_budget > 0 && render_budget < refresh) {
+		next_composite += refresh - render_budget;
+	}
+	if (next_composite <= now_nsec + client_budget_nsec) {
+		return 0;
+	}
+	return next_composite - client_budget_nsec - now_nsec;
+}
+
+void frame_done_send(struct flux_output *output, struct wlr_scene_output *scene_output,
+		uint64_t now_nsec) {
+	if (output->frame_done_delay_msec == 0 || !output->frame_done_timer) {
+		struct timespec now;
+		now.tv_sec = (time_t)(now_nsec / 1000000000ull);
+		now.tv_nsec = (long)(now_nsec % 1000000000ull);
+		wlr_scene_output_send_frame_done(scene_output, &now);
+		return;
+	}
+
+	struct frame_done_iter iter = {0};
+	frame_done_run(output, scene_output, &iter, FRAME_DONE_PASS_IMMEDIATE, now_nsec);
+	if (!iter.any_deferred) {
+		return;
+	}
+
+	uint64_t delay_nsec = frame_done_delay_nsec(output, now_nsec, iter.client_budget_nsec);
+	/* The event loop timer has millisecond resolution; round down to stay early. */
+	int delay_msec = (int)(delay_nsec / 1000000ull);
+	if (delay_msec <= 0) {
+		wl_event_source_timer_update(output->frame_done_timer, 0);
+		frame_done_run(output, scene_output, &iter, FRAME_DONE_PASS_DEFERRED, now_nsec);
+		return;
+	}
+	output->frames_done_deferred++;
+	wl_event_source_timer_update(output->frame_done_timer, delay_msec);
+}
+
+void frame_done_note_commit(struct flux_view *view, uint64_t now_nsec) {
+	if (view->frame_done_nsec == 0 || now_nsec < view->frame_done_nsec) {
+		return;
+	}
+	uint64_t sample = now_nsec - view->frame_done_nsec;
+	view->frame_done_nsec = 0;
+	if (sample > CLIENT_RENDER_MAX_SAMPLE_NSEC) {
+		return;
+	}
+	/* Same 1/8 EWMA as the compositor's own render time. */
+	view->client_render_ewma_nsec = view->client_render_ewma_nsec == 0 ? sample :
+		(view->client_render_ewma_nsec * 7 + sample) / 8;
+}
+
+void frame_done_update_opt_out(struct flux_view *view) {
+	const char *app_id = view->xdg_surface->toplevel ?
+		view->xdg_surface->toplevel->app_id : NULL;
+	view->frame_done_opt_out = app_id &&
+		env_list_contains("FLUX_FRAME_DONE_DELAY_EXCLUDE", app_id);
+}
+
+void frame_done_output_init(struct flux_output *output) {
+	output->frame_done_delay_msec = parse_frame_done_delay(output->wlr_output->name);
+	if (output->frame_done_delay_msec == 0) {
+		return;
+	}
+	output->frame_done_timer = wl_event_loop_add_timer(
+		wl_display_get_event_loop(output->server->display),
+		frame_done_timer_notify, output);
+	if (output->frame_done_delay_msec > 0) {
+		wlr_log(WLR_INFO, "output %s frame-done client budget %dms",
+			output->wlr_output->name, output->frame_done_delay_msec);
+	} else {
+		wlr_log(WLR_INFO, "output %s frame-done delay auto", output->wlr_output->name);
+	}
+}
+
+void frame_done_output_finish(struct flux_output *output) {
+	if (output->frame_done_timer) {
+		wl_event_source_timer_update(output->frame_done_timer, 0);
+	}
+}
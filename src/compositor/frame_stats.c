@@ -0,0 +1,241 @@
+#include "flux.h"
+
+uint64_t timespec_to_nsec(const struct timespec *ts) {
+	return (uint64_t)ts->tv_sec * 1000000000ull + (uint64_t)ts->tv_nsec;
+}
+
+uint64_t monotonic_nsec(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return timespec_to_nsec(&now);
+}
+
+void frame_histogram_record(struct flux_frame_histogram *hist, uint64_t nsec) {
+	uint64_t usec = nsec / 1000ull;
+	uint32_t sample = usec > UINT32_MAX ? UINT32_MAX : (uint32_t)usec;
+
+	hist->samples_usec[hist->next] = sample;
+	hist->next = (hist->next + 1) % FLUX_FRAME_STATS_WINDOW;
+	if (hist->count < FLUX_FRAME_STATS_WINDOW) {
+		hist->count++;
+	}
+	if (sample > hist->max_usec) {
+		hist->max_usec = sample;
+	}
+}
+
+static int compare_u32(const void *a, const void *b) {
+	uint32_t lhs = *(const uint32_t *)a;
+	uint32_t rhs = *(const uint32_t *)b;
+	return (lhs > rhs) - (lhs < rhs);
+}
+
+static double percentile_msec(const uint32_t *sorted, size_t count, double pct) {
+	if (count == 0) {
+		return 0.0;
+	}
+	size_t rank = (size_t)ceil(pct * (double)count);
+	if (rank < 1) {
+		rank = 1;
+	}
+	if (rank > count) {
+		rank = count;
+	}
+	return sorted[rank - 1] / 1000.0;
+}
+
+static void format_histogram(const struct flux_frame_histogram *hist,
+		char *out, size_t out_len) {
+	uint32_t sorted[FLUX_FRAME_STATS_WINDOW];
+	memcpy(sorted, hist->samples_usec, hist->count * sizeof(sorted[0]));
+	qsort(sorted, hist->count, sizeof(sorted[0]), compare_u32);
+
+	snprintf(out, out_len, "p50=%.2fms p95=%.2fms p99=%.2fms max=%.2fms n=%zu",
+		percentile_msec(sorted, hist->count, 0.50),
+		percentile_msec(sorted, hist->count, 0.95),
+		percentile_msec(sorted, hist->count, 0.99),
+		hist->max_usec / 1000.0, hist->count);
+}
+
+uint64_t output_refresh_nsec(struct flux_output *output) {
+	if (output->present_refresh_nsec > 0) {
+		return output->present_refresh_nsec;
+	}
+
+	int refresh_mhz = output->wlr_output->refresh;
+	if (refresh_mhz <= 0) {
+		return 0;
+	}
+	return 1000000000000ull / (uint64_t)refresh_mhz;
+}
+
+/* Next vblank after now, extrapolated from the last presentation timestamp. */
+uint64_t output_predict_present_nsec(struct flux_output *output, uint64_t now_nsec) {
+	uint64_t refresh = output_refresh_nsec(output);
+	if (refresh == 0 || output->last_present_nsec == 0) {
+		return now_nsec + refresh;
+	}
+
+	uint64_t next_vblank = output->last_present_nsec + refresh;
+	if (next_vblank <= now_nsec) {
+		next_vblank += ((now_nsec - next_vblank) / refresh + 1) * refresh;
+	}
+	return next_vblank;
+}
+
+void frame_stats_begin_frame(struct flux_output *output, uint64_t now_nsec) {
+	struct flux_frame_stats *stats = &output->stats;
+
+	/*
+	 * Only a frame that follows a commit is paced by the display; idle gaps
+	 * after skipped frames are expected and would skew the interval data.
+	 */
+	if (stats->last_frame_committed && stats->last_frame_nsec != 0) {
+		uint64_t interval = now_nsec - stats->last_frame_nsec;
+		frame_histogram_record(&stats->interval, interval);
+
+		uint64_t refresh = output_refresh_nsec(output);
+		if (refresh > 0 && interval > refresh + refresh / 2) {
+			stats->missed_refresh++;
+		}
+	}
+	stats->last_frame_nsec = now_nsec;
+	stats->last_frame_committed = false;
+}
+
+static void format_scanout_counts(const struct flux_output *output,
+		char *out, size_t out_len) {
+	size_t used = 0;
+	out[0] = '\0';
+	for (int i = 0; i < FLUX_SCANOUT_RESULT_COUNT && used < out_len; i++) {
+		int n = snprintf(out + used, out_len - used, "%s%s=%llu",
+			i > 0 ? " " : "", scanout_result_name(i),
+			(unsigned long long)output->scanout_counts[i]);
+		if (n < 0) {
+			break;
+		}
+		used += (size_t)n;
+	}
+}
+
+static void frame_stats_write_output(struct flux_output *output, FILE *file) {
+	char callback[128];
+	char commit[128];
+	char interval[128];
+	char scanout[192];
+	format_histogram(&output->stats.callback, callback, sizeof(callback));
+	format_histogram(&output->stats.commit, commit, sizeof(commit));
+	format_histogram(&output->stats.interval, interval, sizeof(interval));
+	format_scanout_counts(output, scanout, sizeof(scanout));
+
+	wlr_log(WLR_INFO,
+		"frame stats %s: rendered=%llu failed=%llu skipped=%llu solid_only=%llu delayed=%llu capped=%llu missed_refresh=%llu animation_saved=%llu frame_done_deferred=%llu taskbar_rebuilds=%llu",
+		output->wlr_output->name,
+		(unsigned long long)output->frames_rendered,
+		(unsigned long long)output->frames_failed,
+		(unsigned long long)output->frames_skipped,
+		(unsigned long long)output->frames_solid_only,
+		(unsigned long long)output->frames_delayed,
+		(unsigned long long)output->frames_capped,
+		(unsigned long long)output->stats.missed_refresh,
+		(unsigned long long)output->animation_frames_saved,
+		(unsigned long long)output->frames_done_deferred,
+		(unsigned long long)output->taskbar_rebuilds);
+	wlr_log(WLR_INFO, "frame stats %s: presented async=%llu vsync=%llu async_fallbacks=%llu",
+		output->wlr_output->name,
+		(unsigned long long)output->frames_async,
+		(unsigned long long)output->frames_vsync,
+		(unsigned long long)output->async_fallbacks);
+	wlr_log(WLR_INFO, "frame stats %s: callback %s", output->wlr_output->name, callback);
+	wlr_log(WLR_INFO, "frame stats %s: commit %s", output->wlr_output->name, commit);
+	wlr_log(WLR_INFO, "frame stats %s: interval %s", output->wlr_output->name, interval);
+	wlr_log(WLR_INFO, "frame stats %s: direct scanout %s", output->wlr_output->name, scanout);
+	const char *cursor_path = cursor_path_name(output->cursor_path);
+	wlr_log(WLR_INFO, "frame stats %s: cursor path=%s composites_avoided=%llu",
+		output->wlr_output->name, cursor_path,
+		(unsigned long long)output->cursor_frames_avoided);
+	if (output->server->soft_compositor) {
+		wlr_log(WLR_INFO, "frame stats %s: soft compositor frames=%llu fallbacks=%llu verify_mismatches=%llu",
+			output->wlr_output->name,
+			(unsigned long long)output->frames_soft,
+			(unsigned long long)output->soft_fallbacks,
+			(unsigned long long)output->soft_verify_mismatches);
+	}
+	char mirror_copy[128] = "";
+	if (output_is_mirror(output)) {
+		format_histogram(&output->stats.mirror_copy, mirror_copy, sizeof(mirror_copy));
+		wlr_log(WLR_INFO, "frame stats %s: mirror copy from %s %s",
+			output->wlr_output->name, output->mirror_of, mirror_copy);
+	}
+
+	if (file) {
+		fprintf(file, "output %s\n", output->wlr_output->name);
+		fprintf(file, "  rendered %llu\n", (unsigned long long)output->frames_rendered);
+		fprintf(file, "  failed %llu\n", (unsigned long long)output->frames_failed);
+		fprintf(file, "  skipped %llu\n", (unsigned long long)output->frames_skipped);
+		fprintf(file, "  solid_only %llu\n", (unsigned long long)output->frames_solid_only);
+		fprintf(file, "  delayed %llu\n", (unsigned long long)output->frames_delayed);
+		fprintf(file, "  capped %llu\n", (unsigned long long)output->frames_capped);
+		fprintf(file, "  missed_refresh %llu\n",
+			(unsigned long long)output->stats.missed_refresh);
+		fprintf(file, "  animation_saved %llu\n",
+			(unsigned long long)output->animation_frames_saved);
+		fprintf(file, "  frame_done_deferred %llu\n",
+			(unsigned long long)output->frames_done_deferred);
+		fprintf(file, "  taskbar_rebuilds %llu\n",
+			(unsigned long long)output->taskbar_rebuilds);
+		fprintf(file, "  async %llu\n", (unsigned long long)output->frames_async);
+		fprintf(file, "  vsync %llu\n", (unsigned long long)output->frames_vsync);
+		fprintf(file, "  async_fallbacks %llu\n",
+			(unsigned long long)output->async_fallbacks);
+		fprintf(file, "  callback %s\n", callback);
+		fprintf(file, "  commit %s\n", commit);
+		fprintf(file, "  interval %s\n", interval);
+		fprintf(file, "  direct_scanout %s\n", scanout);
+		fprintf(file, "  cursor_path %s\n", cursor_path);
+		fprintf(file, "  cursor_composites_avoided %llu\n",
+			(unsigned long long)output->cursor_frames_avoided);
+		if (output->server->soft_compositor) {
+			fprintf(file, "  soft_frames %llu\n", (unsigned long long)output->frames_soft);
+			fprintf(file, "  soft_fallbacks %llu\n",
+				(unsigned long long)output->soft_fallbacks);
+			fprintf(file, "  soft_verify_mismatches %llu\n",
+				(unsigned long long)output->soft_verify_mismatches);
+		}
+		if (output_is_mirror(output)) {
+			fprintf(file, "  mirror_copy %s\n", mirror_copy);
+		}
+	}
+}
+
+void frame_stats_log_output(struct flux_output *output) {
+	frame_stats_write_output(output, NULL);
+}
+
+void frame_stats_dump(struct flux_server *server) {
+	FILE *file = NULL;
+	const char *path = getenv("FLUX_FRAME_STATS_FILE");
+	if (path && path[0] != '\0') {
+		file = fopen(path, "w");
+		if (!file) {
+			wlr_log(WLR_ERROR, "failed to open frame stats file %s: %s",
+				path, strerror(errno));
+		}
+	}
+
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		frame_stats_write_output(output, file);
+	}
+
+	if (file) {
+		fclose(file);
+		wlr_log(WLR_INFO, "frame stats written to %s", path);
+	}
+}
+
+int handle_frame_stats_signal(int signal_number, void *data) {
+	(void)signal_number;
+	frame_stats_dump(data);
+	return 0;
+}
@@ -0,0 +1,330 @@
+#include "flux.h"
+
+#include <drm_fourcc.h>
+#include <wlr/interfaces/wlr_buffer.h>
+
+/* Logical size of the HUD; the buffer is this times the output's ceil(scale). */
+#define HUD_WIDTH 200
+#define HUD_HEIGHT 92
+#define HUD_MARGIN 8
+#define HUD_PAD 4
+#define HUD_GLYPH_W 5
+#define HUD_GLYPH_H 7
+#define HUD_LINE_H 10
+#define HUD_GRAPH_Y (HUD_PAD + HUD_LINE_H * 2 + 2)
+#define HUD_GRAPH_H (HUD_HEIGHT - HUD_GRAPH_Y - HUD_PAD)
+#define HUD_SAMPLES (HUD_WIDTH - HUD_PAD * 2)
+/* Redrawing every frame would keep the output busy just to show itself. */
+#define HUD_REDRAW_MSEC 250
+#define HUD_RATE_MSEC 1000
+
+/* Premultiplied ARGB8888. */
+#define HUD_COLOR_BG 0xc00c0c0cu
+#define HUD_COLOR_TEXT 0xffffffffu
+#define HUD_COLOR_OK 0xff40c040u
+#define HUD_COLOR_LATE 0xffe04040u
+#define HUD_COLOR_TARGET 0xffffd020u
+
+struct flux_hud_buffer {
+	struct wlr_buffer base;
+	uint32_t *data;
+	size_t stride;
+};
+
+struct flux_hud {
+	struct flux_hud_buffer *buffer;
+	struct wlr_scene_buffer *node;
+	int pixel_scale;
+
+	uint32_t samples_usec[HUD_SAMPLES];
+	size_t sample_next;
+	size_t interval_seen;
+	uint64_t last_redraw_msec;
+
+	uint64_t rate_start_msec;
+	uint64_t rate_frames;
+	uint64_t rate_client_commits;
+	uint64_t rate_input_events;
+	double commits_per_sec;
+	double client_commits_per_sec;
+	double input_per_sec;
+};
+
+static struct flux_hud_buffer *hud_buffer_from_base(struct wlr_buffer *buffer) {
+	struct flux_hud_buffer *hud_buffer = wl_container_of(buffer, hud_buffer, base);
+	return hud_buffer;
+}
+
+static void hud_buffer_destroy(struct wlr_buffer *buffer) {
+	struct flux_hud_buffer *hud_buffer = hud_buffer_from_base(buffer);
+	free(hud_buffer->data);
+	free(hud_buffer);
+}
+
+static bool hud_buffer_begin_data_ptr_access(struct wlr_buffer *buffer,
+		uint32_t flags, void **data, uint32_t *format, size_t *stride) {
+	(void)flags;
+	struct flux_hud_buffer *hud_buffer = hud_buffer_from_base(buffer);
+	*data = hud_buffer->data;
+	*format = DRM_FORMAT_ARGB8888;
+	*stride = hud_buffer->stride;
+	return true;
+}
+
+static void hud_buffer_end_data_ptr_access(struct wlr_buffer *buffer) {
+	(void)buffer;
+}
+
+static const struct wlr_buffer_impl hud_buffer_impl = {
+	.destroy = hud_buffer_destroy,
+	.begin_data_ptr_access = hud_buffer_begin_data_ptr_access,
+	.end_data_ptr_access = hud_buffer_end_data_ptr_access,
+};
+
+static struct flux_hud_buffer *hud_buffer_create(int width, int height) {
+	struct flux_hud_buffer *hud_buffer = calloc(1, sizeof(*hud_buffer));
+	if (!hud_buffer) {
+		return NULL;
+	}
+	hud_buffer->data = calloc((size_t)width * (size_t)height, sizeof(uint32_t));
+	if (!hud_buffer->data) {
+		free(hud_buffer);
+		return NULL;
+	}
+	hud_buffer->stride = (size_t)width * 4;
+	wlr_buffer_init(&hud_buffer->base, &hud_buffer_impl, width, height);
+	return hud_buffer;
+}
+
+/* Fill a rect given in logical HUD coordinates, clipped to the buffer. */
+static void hud_fill(struct flux_hud *hud, int x, int y, int w, int h, uint32_t color) {
+	int k = hud->pixel_scale;
+	int bw = hud->buffer->base.width;
+	int bh = hud->buffer->base.height;
+	int x0 = x * k, y0 = y * k;
+	int x1 = (x + w) * k, y1 = (y + h) * k;
+	if (x0 < 0) {
+		x0 = 0;
+	}
+	if (y0 < 0) {
+		y0 = 0;
+	}
+	if (x1 > bw) {
+		x1 = bw;
+	}
+	if (y1 > bh) {
+		y1 = bh;
+	}
+	for (int py = y0; py < y1; py++) {
+		uint32_t *row = hud->buffer->data + (size_t)py * (size_t)bw;
+		for (int px = x0; px < x1; px++) {
+			row[px] = color;
+		}
+	}
+}
+
+static void hud_text(struct flux_hud *hud, int x, int y, const char *text) {
+	for (; *text; text++, x += HUD_GLYPH_W + 1) {
+		const uint8_t *rows = taskbar_glyph_rows(*text);
+		for (int gy = 0; gy < HUD_GLYPH_H; gy++) {
+			for (int gx = 0; gx < HUD_GLYPH_W; gx++) {
+				if (rows[gy] & (1u << (HUD_GLYPH_W - 1 - gx))) {
+					hud_fill(hud, x + gx, y + gy, 1, 1, HUD_COLOR_TEXT);
+				}
+			}
+		}
+	}
+}
+
+static void hud_take_samples(struct flux_output *output, struct flux_hud *hud) {
+	const struct flux_frame_histogram *interval = &output->stats.interval;
+	size_t pending = (interval->next + FLUX_FRAME_STATS_WINDOW - hud->interval_seen) %
+		FLUX_FRAME_STATS_WINDOW;
+	for (size_t i = 0; i < pending; i++) {
+		size_t idx = (hud->interval_seen + i) % FLUX_FRAME_STATS_WINDOW;
+		hud->samples_usec[hud->sample_next] = interval->samples_usec[idx];
+		hud->sample_next = (hud->sample_next + 1) % HUD_SAMPLES;
+	}
+	hud->interval_seen = interval->next;
+}
+
+static void hud_update_rates(struct flux_output *output, struct flux_hud *hud,
+		uint64_t now_msec) {
+	struct flux_server *server = output->server;
+	uint64_t elapsed = now_msec - hud->rate_start_msec;
+	if (hud->rate_start_msec != 0 && elapsed < HUD_RATE_MSEC) {
+		return;
+	}
+	if (hud->rate_start_msec != 0 && elapsed > 0) {
+		double sec = (double)elapsed / 1000.0;
+		hud->commits_per_sec = (double)(output->frames_rendered - hud->rate_frames) / sec;
+		hud->client_commits_per_sec =
+			(double)(server->client_commits - hud->rate_client_commits) / sec;
+		hud->input_per_sec = (double)(server->input_events - hud->rate_input_events) / sec;
+	}
+	hud->rate_start_msec = now_msec;
+	hud->rate_frames = output->frames_rendered;
+	hud->rate_client_commits = server->client_commits;
+	hud->rate_input_events = server->input_events;
+}
+
+static void hud_draw(struct flux_output *output, struct flux_hud *hud) {
+	hud_fill(hud, 0, 0, HUD_WIDTH, HUD_HEIGHT, HUD_COLOR_BG);
+
+	char line[48];
+	snprintf(line, sizeof(line), "CMP %.2fMS  FPS %.0f",
+		output->render_ewma_nsec / 1000000.0, hud->commits_per_sec);
+	hud_text(hud, HUD_PAD, HUD_PAD, line);
+	snprintf(line, sizeof(line), "CLI %.0f/S  IN %.0f/S",
+		hud->client_commits_per_sec, hud->input_per_sec);
+	hud_text(hud, HUD_PAD, HUD_PAD + HUD_LINE_H, line);
+
+	/* The graph spans two refresh periods so the target sits mid-height. */
+	uint64_t refresh_usec = output_refresh_nsec(output) / 1000ull;
+	if (refresh_usec == 0) {
+		refresh_usec = 16667;
+	}
+	uint64_t range_usec = refresh_usec * 2;
+	int base_y = HUD_GRAPH_Y + HUD_GRAPH_H;
+	for (int i = 0; i < HUD_SAMPLES; i++) {
+		/* Oldest sample on the left, newest on the right. */
+		uint32_t usec = hud->samples_usec[(hud->sample_next + (size_t)i) % HUD_SAMPLES];
+		if (usec == 0) {
+			continue;
+		}
+		uint64_t clamped = usec < range_usec ? usec : range_usec;
+		int h = (int)(clamped * (uint64_t)HUD_GRAPH_H / range_usec);
+		if (h < 1) {
+			h = 1;
+		}
+		uint32_t color = usec > refresh_usec + refresh_usec / 2 ? HUD_COLOR_LATE : HUD_COLOR_OK;
+		hud_fill(hud, HUD_PAD + i, base_y - h, 1, h, color);
+	}
+	hud_fill(hud, HUD_PAD, base_y - HUD_GRAPH_H / 2, HUD_SAMPLES, 1, HUD_COLOR_TARGET);
+}
+
+static void hud_destroy(struct flux_output *output) {
+	struct flux_hud *hud = output->hud;
+	if (!hud) {
+		return;
+	}
+	if (hud->node) {
+		wlr_scene_node_destroy(&hud->node->node);
+	}
+	if (hud->buffer) {
+		wlr_buffer_drop(&hud->buffer->base);
+	}
+	free(hud);
+	output->hud = NULL;
+}
+
+static struct flux_hud *hud_ensure(struct flux_output *output) {
+	struct flux_server *server = output->server;
+	int pixel_scale = (int)ceilf(output->wlr_output->scale);
+	if (pixel_scale < 1) {
+		pixel_scale = 1;
+	}
+	if (output->hud && output->hud->pixel_scale == pixel_scale) {
+		return output->hud;
+	}
+	hud_destroy(output);
+
+	struct flux_hud *hud = calloc(1, sizeof(*hud));
+	if (!hud) {
+		return NULL;
+	}
+	hud->pixel_scale = pixel_scale;
+	hud->buffer = hud_buffer_create(HUD_WIDTH * pixel_scale, HUD_HEIGHT * pixel_scale);
+	if (hud->buffer) {
+		hud->node = wlr_scene_buffer_create(server->hud_tree, &hud->buffer->base);
+	}
+	if (!hud->node) {
+		if (hud->buffer) {
+			wlr_buffer_drop(&hud->buffer->base);
+		}
+		free(hud);
+		return NULL;
+	}
+	wlr_scene_buffer_set_dest_size(hud->node, HUD_WIDTH, HUD_HEIGHT);
+	wlr_scene_buffer_set_filter_mode(hud->node, render_profile_scale_filter(server));
+	hud->interval_seen = output->stats.interval.next;
+	output->hud = hud;
+	return hud;
+}
+
+static int hud_timer_notify(void *data) {
+	struct flux_server *server = data;
+	if (!server->hud_enabled) {
+		return 0;
+	}
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->wlr_output->enabled && !output_is_mirror(output)) {
+			wlr_output_schedule_frame(output->wlr_output);
+		}
+	}
+	wl_event_source_timer_update(server->hud_timer, HUD_REDRAW_MSEC);
+	return 0;
+}
+
+bool hud_init(struct flux_server *server) {
+	server->hud_tree = wlr_scene_tree_create(&server->scene->tree);
+	server->hud_timer = wl_event_loop_add_timer(
+		wl_display_get_event_loop(server->display), hud_timer_notify, server);
+	if (!server->hud_tree || !server->hud_timer) {
+		return false;
+	}
+	if (env_int("FLUX_HUD", 0) != 0) {
+		hud_toggle(server);
+	}
+	return true;
+}
+
+void hud_toggle(struct flux_server *server) {
+	server->hud_enabled = !server->hud_enabled;
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		hud_destroy(output);
+		wlr_output_schedule_frame(output->wlr_output);
+	}
+	wl_event_source_timer_update(server->hud_timer,
+		server->hud_enabled ? HUD_REDRAW_MSEC : 0);
+	wlr_log(WLR_INFO, "frame-time HUD %s", server->hud_enabled ? "on" : "off");
+}
+
+void hud_output_tick(struct flux_output *output, uint32_t now_msec) {
+	struct flux_server *server = output->server;
+	if (!server->hud_enabled || output_is_mirror(output)) {
+		return;
+	}
+	struct flux_hud *hud = hud_ensure(output);
+	if (!hud) {
+		return;
+	}
+	hud_take_samples(output, hud);
+	if (hud->last_redraw_msec != 0 && now_msec - hud->last_redraw_msec < HUD_REDRAW_MSEC) {
+		return;
+	}
+	hud->last_redraw_msec = now_msec;
+	hud_update_rates(output, hud, now_msec);
+
+	struct wlr_box box;
+	wlr_output_layout_get_box(server->output_layout, output->wlr_output, &box);
+	wlr_scene_node_set_position(&hud->node->node,
+		box.x + box.width - HUD_WIDTH - HUD_MARGIN, box.y + HUD_MARGIN);
+	hud_draw(output, hud);
+	/* Same buffer, new contents: re-setting it drops the cached texture. */
+	wlr_scene_buffer_set_buffer_with_damage(hud->node, &hud->buffer->base, NULL);
+
+	wlr_scene_node_raise_to_top(&server->hud_tree->node);
+	if (server->damage_overlay_tree) {
+		wlr_scene_node_raise_to_top(&server->damage_overlay_tree->node);
+	}
+	if (server->cursor_tree) {
+		wlr_scene_node_raise_to_top(&server->cursor_tree->node);
+	}
+}
+
+void hud_output_destroy(struct flux_output *output) {
+	hud_destroy(output);
+}
@@ -0,0 +1,168 @@
+#include "flux.h"
+
+struct flux_idle_inhibitor {
+	struct flux_server *server;
+	struct wl_listener destroy;
+};
+
+/* How soon an output that refused a power change is tried again. */
+#define IDLE_POWER_RETRY_MSEC 1000
+
+/*
+ * Returns whether every output reached the requested state. Outputs that
+ * refused keep their old idle_off, so the next call tries them again.
+ */
+static bool set_outputs_power(struct flux_server *server, bool on) {
+	server->outputs_idle_off = !on;
+	int changed = 0, failed = 0;
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->idle_off != on) {
+			continue;
+		}
+		if (output_set_power(output, on)) {
+			output->idle_off = !on;
+			changed++;
+		} else {
+			failed++;
+		}
+	}
+	if (changed > 0 || failed > 0) {
+		wlr_log(WLR_INFO, "idle: %d output(s) powered %s, %d failed",
+			changed, on ? "on" : "off", failed);
+	}
+	return failed == 0;
+}
+
+static void idle_arm_timer(struct flux_server *server, uint32_t delay_msec) {
+	if (!server->idle_timer || server->idle_timeout_msec == 0) {
+		return;
+	}
+	wl_event_source_timer_update(server->idle_timer, delay_msec > 0 ? delay_msec : 1);
+	server->idle_timer_armed = true;
+}
+
+static int idle_timer_notify(void *data) {
+	struct flux_server *server = data;
+	server->idle_timer_armed = false;
+
+	/*
+	 * Input only stamps the activity time; the timer re-arms itself for the
+	 * remainder so high-rate pointer motion never touches the timerfd.
+	 */
+	uint64_t idle_nsec = monotonic_nsec() - server->idle_last_activity_nsec;
+	uint64_t timeout_nsec = (uint64_t)server->idle_timeout_msec * 1000000ull;
+	if (idle_nsec < timeout_nsec) {
+		/* Not idle: finish switching on outputs that refused at the last input. */
+		uint32_t delay = set_outputs_power(server, true) ?
+			(uint32_t)((timeout_nsec - idle_nsec) / 1000000ull) : IDLE_POWER_RETRY_MSEC;
+		idle_arm_timer(server, delay);
+		return 0;
+	}
+	if (server->idle_inhibitor_count > 0) {
+		wlr_log(WLR_DEBUG, "idle: timeout reached but %d inhibitor(s) active",
+			server->idle_inhibitor_count);
+		return 0;
+	}
+	if (!set_outputs_power(server, false)) {
+		idle_arm_timer(server, IDLE_POWER_RETRY_MSEC);
+	}
+	return 0;
+}
+
+/* An output that appears while idle has powered the others off joins them. */
+void idle_output_added(struct flux_output *output) {
+	struct flux_server *server = output->server;
+	if (!server->outputs_idle_off) {
+		return;
+	}
+	if (output_set_power(output, false)) {
+		output->idle_off = true;
+	} else if (!server->idle_timer_armed) {
+		idle_arm_timer(server, IDLE_POWER_RETRY_MSEC);
+	}
+}
+
+void idle_notify_activity(struct flux_server *server) {
+	server->input_events++;
+	server->idle_last_activity_nsec = monotonic_nsec();
+	if (server->idle_notifier) {
+		wlr_idle_notifier_v1_notify_activity(server->idle_notifier, server->seat);
+	}
+	if (server->outputs_idle_off && !set_outputs_power(server, true)) {
+		idle_arm_timer(server, IDLE_POWER_RETRY_MSEC);
+	}
+	if (!server->idle_timer_armed) {
+		idle_arm_timer(server, server->idle_timeout_msec);
+	}
+}
+
+static void idle_update_inhibited(struct flux_server *server) {
+	bool inhibited = server->idle_inhibitor_count > 0;
+	wlr_idle_notifier_v1_set_inhibited(server->idle_notifier, inhibited);
+	if (!inhibited && !server->idle_timer_armed) {
+		/* The full timeout restarts once the last inhibitor goes away. */
+		server->idle_last_activity_nsec = monotonic_nsec();
+		idle_arm_timer(server, server->idle_timeout_msec);
+	}
+}
+
+static void idle_inhibitor_destroy_notify(struct wl_listener *listener, void *data) {
+	(void)data;
+	struct flux_idle_inhibitor *inhibitor = wl_container_of(listener, inhibitor, destroy);
+	struct flux_server *server = inhibitor->server;
+	wl_list_remove(&inhibitor->destroy.link);
+	free(inhibitor);
+
+	server->idle_inhibitor_count--;
+	wlr_log(WLR_INFO, "idle: inhibitor removed (%d active)", server->idle_inhibitor_count);
+	idle_update_inhibited(server);
+}
+
+static void new_idle_inhibitor_notify(struct wl_listener *listener, void *data) {
+	struct flux_server *server = wl_container_of(listener, server, new_idle_inhibitor);
+	struct wlr_idle_inhibitor_v1 *wlr_inhibitor = data;
+
+	struct flux_idle_inhibitor *inhibitor = calloc(1, sizeof(*inhibitor));
+	if (!inhibitor) {
+		wlr_log(WLR_ERROR, "failed to allocate idle inhibitor state");
+		return;
+	}
+	inhibitor->server = server;
+	inhibitor->destroy.notify = idle_inhibitor_destroy_notify;
+	wl_signal_add(&wlr_inhibitor->events.destroy, &inhibitor->destroy);
+
+	server->idle_inhibitor_count++;
+	wlr_log(WLR_INFO, "idle: inhibitor added (%d active)", server->idle_inhibitor_count);
+	idle_update_inhibited(server);
+}
+
+bool idle_init(struct flux_server *server) {
+	server->idle_notifier = wlr_idle_notifier_v1_create(server->display);
+	server->idle_inhibit_manager = wlr_idle_inhibit_v1_create(server->display);
+	if (!server->idle_notifier || !server->idle_inhibit_manager) {
+		return false;
+	}
+	server->new_idle_inhibitor.notify = new_idle_inhibitor_notify;
+	wl_signal_add(&server->idle_inhibit_manager->events.new_inhibitor,
+		&server->new_idle_inhibitor);
+
+	int timeout_sec = env_int("FLUX_IDLE_TIMEOUT", 0);
+	if (timeout_sec <= 0) {
+		wlr_log(WLR_INFO, "idle: output power-down disabled");
+		return true;
+	}
+	if (timeout_sec > INT_MAX / 1000) {
+		timeout_sec = INT_MAX / 1000;
+	}
+	server->idle_timeout_msec = (uint32_t)timeout_sec * 1000u;
+	server->idle_timer = wl_event_loop_add_timer(
+		wl_display_get_event_loop(server->display), idle_timer_notify, server);
+	if (!server->idle_timer) {
+		return false;
+	}
+	server->idle_last_activity_nsec = monotonic_nsec();
+	idle_arm_timer(server, server->idle_timeout_msec);
+	wlr_log(WLR_INFO, "idle: outputs power down after %ds without input", timeout_sec);
+	return true;
+}
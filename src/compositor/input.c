@@ -103,6 +103,7 @@ static void keyboard_key_notify(struct wl_listener *listener, void *data) {
 	struct wlr_keyboard_key_event *event = data;
 
 	wlr_seat_set_keyboard(server->seat, keyboard->wlr_keyboard);
+	idle_notify_activity(server);
 
 	bool handled = false;
 	uint32_t keycode = event->keycode + 8;
@@ -124,6 +125,21 @@ static void keyboard_key_notify(struct wl_listener *listener, void *data) {
 				handled = true;
 				break;
 			}
+			if (syms[i] == XKB_KEY_r) {
+				output_toggle_refresh_policy(server);
+				handled = true;
+				break;
+			}
+			if (syms[i] == XKB_KEY_d) {
+				damage_debug_toggle(server);
+				handled = true;
+				break;
+			}
+			if (syms[i] == XKB_KEY_h) {
+				hud_toggle(server);
+				handled = true;
+				break;
+			}
 			if (syms[i] == XKB_KEY_m) {
 				maybe_restore_last_minimized(server, event->time_msec);
 				handled = true;
@@ -190,12 +206,12 @@ static void maybe_enable_parallels_cursor_compat(struct flux_server *server,
 		return;
 	}
 
-	if (!server->use_drawn_cursor) {
+	if (!server->use_drawn_cursor || server->cursor_plane) {
+		/* The cursor plane is what misbehaves here: keep the pointer in the scene. */
 		server->use_drawn_cursor = true;
+		server->cursor_plane = false;
 		wlr_cursor_unset_image(server->cursor);
-		if (!server->cursor_tree) {
-			create_cursor_pointer(server);
-		}
+		cursor_reload_custom(server);
 
 		wlr_log(WLR_INFO,
 			"Parallels pointer detected; enabling drawn-cursor compatibility");
@@ -0,0 +1,143 @@
+#include "flux.h"
+
+bool output_is_mirror(const struct flux_output *output) {
+	return output->mirror_of[0] != '\0';
+}
+
+static void mirror_set_pending(struct flux_output *mirror, struct wlr_buffer *buffer) {
+	if (mirror->mirror_buffer) {
+		wlr_buffer_unlock(mirror->mirror_buffer);
+	}
+	mirror->mirror_buffer = buffer ? wlr_buffer_lock(buffer) : NULL;
+}
+
+void mirror_source_committed(struct flux_output *source, struct wlr_buffer *buffer) {
+	struct flux_output *mirror;
+	wl_list_for_each(mirror, &source->server->outputs, link) {
+		if (!output_is_mirror(mirror) || !mirror->wlr_output->enabled ||
+				strcmp(mirror->mirror_of, source->wlr_output->name) != 0) {
+			continue;
+		}
+		/* Keep only the newest frame; a slow mirror simply drops stale ones. */
+		mirror_set_pending(mirror, buffer);
+		wlr_output_schedule_frame(mirror->wlr_output);
+	}
+}
+
+void mirror_release(struct flux_output *mirror) {
+	mirror_set_pending(mirror, NULL);
+}
+
+static bool output_has_mirror(struct flux_output *source) {
+	struct flux_output *mirror;
+	wl_list_for_each(mirror, &source->server->outputs, link) {
+		if (output_is_mirror(mirror) && mirror->wlr_output->enabled &&
+				strcmp(mirror->mirror_of, source->wlr_output->name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Mirrors copy the source's primary buffer, which never holds the hardware
+ * cursor. While a source has an enabled mirror its cursor is drawn into the
+ * frame instead, so the copy shows the pointer as well.
+ */
+void mirror_update_cursors(struct flux_server *server) {
+	struct flux_output *source;
+	wl_list_for_each(source, &server->outputs, link) {
+		if (output_is_mirror(source)) {
+			continue;
+		}
+		bool lock = output_has_mirror(source);
+		if (lock == source->mirror_cursor_locked) {
+			continue;
+		}
+		wlr_output_lock_software_cursors(source->wlr_output, lock);
+		source->mirror_cursor_locked = lock;
+		wlr_log(WLR_INFO, "output %s: %s software cursor for its mirror",
+			source->wlr_output->name, lock ? "using" : "dropping");
+	}
+}
+
+static void fit_preserving_aspect(int src_w, int src_h, int dst_w, int dst_h,
+		struct wlr_box *out) {
+	/* Compare src_w/src_h with dst_w/dst_h without floating point. */
+	if ((int64_t)src_w * dst_h > (int64_t)dst_w * src_h) {
+		out->width = dst_w;
+		out->height = (int)((int64_t)src_h * dst_w / src_w);
+	} else {
+		out->height = dst_h;
+		out->width = (int)((int64_t)src_w * dst_h / src_h);
+	}
+	out->x = (dst_w - out->width) / 2;
+	out->y = (dst_h - out->height) / 2;
+}
+
+/*
+ * Present the source output's last committed buffer on a mirror. The scene is
+ * never walked here: the source frame is sampled as one texture and scaled
+ * into a letterboxed box with a single render pass.
+ */
+void mirror_repaint(struct flux_output *mirror) {
+	struct wlr_buffer *buffer = mirror->mirror_buffer;
+	if (!buffer) {
+		mirror->frames_skipped++;
+		return;
+	}
+
+	uint64_t start_nsec = monotonic_nsec();
+	frame_stats_begin_frame(mirror, start_nsec);
+
+	struct wlr_output *wlr_output = mirror->wlr_output;
+	/* Direct-scanout frames are client buffers that already own a texture. */
+	struct wlr_client_buffer *client_buffer = wlr_client_buffer_get(buffer);
+	struct wlr_texture *texture = client_buffer ? client_buffer->texture :
+		wlr_texture_from_buffer(mirror->server->renderer, buffer);
+	if (!texture) {
+		wlr_log(WLR_ERROR, "mirror %s: cannot sample %s frame",
+			wlr_output->name, mirror->mirror_of);
+		mirror_set_pending(mirror, NULL);
+		return;
+	}
+
+	int width = 0, height = 0;
+	wlr_output_transformed_resolution(wlr_output, &width, &height);
+	struct wlr_box dst = {0};
+	fit_preserving_aspect(buffer->width, buffer->height, width, height, &dst);
+
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	struct wlr_render_pass *pass = wlr_output_begin_render_pass(wlr_output, &state, NULL);
+	bool committed = false;
+	if (pass) {
+		wlr_render_pass_add_rect(pass, &(struct wlr_render_rect_options){
+			.box = { .width = width, .height = height },
+			.color = { .r = 0.0f, .g = 0.0f, .b = 0.0f, .a = 1.0f },
+		});
+		wlr_render_pass_add_texture(pass, &(struct wlr_render_texture_options){
+			.texture = texture,
+			.dst_box = dst,
+			.filter_mode = WLR_SCALE_FILTER_BILINEAR,
+			.blend_mode = WLR_RENDER_BLEND_MODE_NONE,
+		});
+		committed = wlr_render_pass_submit(pass) &&
+			wlr_output_commit_state(wlr_output, &state);
+	}
+	wlr_output_state_finish(&state);
+	if (!client_buffer) {
+		wlr_texture_destroy(texture);
+	}
+	mirror_set_pending(mirror, NULL);
+
+	uint64_t end_nsec = monotonic_nsec();
+	frame_histogram_record(&mirror->stats.mirror_copy, end_nsec - start_nsec);
+	if (committed) {
+		mirror->stats.last_frame_committed = true;
+		mirror->frames_rendered++;
+	} else {
+		mirror->frames_failed++;
+		wlr_log(WLR_ERROR, "mirror %s: commit failed", wlr_output->name);
+	}
+}
@@ -14,12 +14,353 @@ static void update_output_background(struct flux_output *output) {
 	wlr_scene_rect_set_size(output->background_rect, box.width, box.height);
 	wlr_scene_node_set_position(&output->background_rect->node, box.x, box.y);
 	wlr_scene_node_lower_to_bottom(&output->background_rect->node);
+	wallpaper_output_update(output);
 }
 
-static void output_frame_notify(struct wl_listener *listener, void *data) {
+void output_set_background_enabled(struct flux_output *output, bool enabled) {
+	if (output->background_rect) {
+		wlr_scene_node_set_enabled(&output->background_rect->node, enabled);
+	}
+	if (output->wallpaper_node) {
+		wlr_scene_node_set_enabled(&output->wallpaper_node->node, enabled);
+	}
+}
+
+void output_layout_change_notify(struct wl_listener *listener, void *data) {
 	(void)data;
-	struct flux_output *output = wl_container_of(listener, output, frame);
+	struct flux_server *server = wl_container_of(listener, server, output_layout_change);
+
+	/* Background geometry only depends on the layout, so refresh it here. */
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		update_output_background(output);
+	}
+	view_index_rebuild(server);
+	taskbar_mark_dirty(server);
+}
+
+static const char *vrr_mode_name(enum flux_vrr_mode mode) {
+	switch (mode) {
+	case FLUX_VRR_ON:
+		return "on";
+	case FLUX_VRR_AUTO:
+		return "auto";
+	case FLUX_VRR_OFF:
+	default:
+		return "off";
+	}
+}
+
+static void log_adaptive_sync_status(struct flux_output *output, const char *reason) {
+	bool engaged = output->wlr_output->adaptive_sync_status ==
+		WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED;
+	wlr_log(WLR_INFO, "output %s adaptive sync %s (%s, mode=%s supported=%d)",
+		output->wlr_output->name, engaged ? "engaged" : "disengaged", reason,
+		vrr_mode_name(output->vrr_mode), output->wlr_output->adaptive_sync_supported);
+}
+
+static bool output_wants_adaptive_sync(struct flux_output *output, uint32_t now_msec) {
+	switch (output->vrr_mode) {
+	case FLUX_VRR_ON:
+		return true;
+	case FLUX_VRR_AUTO:
+		break;
+	case FLUX_VRR_OFF:
+	default:
+		return false;
+	}
+
 	struct flux_server *server = output->server;
+	struct flux_view *view =
+		view_from_surface(server, server->seat->keyboard_state.focused_surface);
+	if (!view_is_actively_rendering(view, now_msec)) {
+		return false;
+	}
+
+	struct wlr_box box = {
+		.x = view->x,
+		.y = view->y,
+		.width = view->width,
+		.height = view->height,
+	};
+	return wlr_output_layout_intersects(server->output_layout, output->wlr_output, &box);
+}
+
+const char *scanout_result_name(enum flux_scanout_result result) {
+	switch (result) {
+	case FLUX_SCANOUT_USED:
+		return "scanout";
+	case FLUX_SCANOUT_NO_FULLSCREEN:
+		return "no_fullscreen";
+	case FLUX_SCANOUT_VIEW_HIDDEN:
+		return "view_hidden";
+	case FLUX_SCANOUT_GEOMETRY:
+		return "geometry";
+	case FLUX_SCANOUT_OVERLAY:
+		return "overlay";
+	case FLUX_SCANOUT_REJECTED:
+		return "rejected";
+	case FLUX_SCANOUT_RESULT_COUNT:
+		break;
+	}
+	return "unknown";
+}
+
+const char *cursor_path_name(enum flux_cursor_path path) {
+	switch (path) {
+	case FLUX_CURSOR_PATH_NONE:
+		return "none";
+	case FLUX_CURSOR_PATH_SCENE:
+		return "scene";
+	case FLUX_CURSOR_PATH_PLANE:
+		return "plane";
+	case FLUX_CURSOR_PATH_SOFTWARE:
+		return "software";
+	}
+	return "unknown";
+}
+
+struct scanout_scan {
+	struct flux_view *view;
+	struct wlr_buffer *committed;
+	bool view_buffer_committed;
+	int view_buffers;
+	int other_buffers;
+};
+
+static bool scene_node_is_within(struct wlr_scene_node *node, struct wlr_scene_tree *tree) {
+	for (struct wlr_scene_tree *parent = node->parent; parent; parent = parent->node.parent) {
+		if (parent == tree) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void scanout_scan_buffer(struct wlr_scene_buffer *buffer, int sx, int sy, void *data) {
+	(void)sx;
+	(void)sy;
+	struct scanout_scan *scan = data;
+	if (!buffer->node.enabled || !buffer->buffer) {
+		return;
+	}
+	if (scene_node_is_within(&buffer->node, scan->view->content_tree)) {
+		scan->view_buffers++;
+		if (buffer->buffer == scan->committed) {
+			scan->view_buffer_committed = true;
+		}
+	} else {
+		scan->other_buffers++;
+	}
+}
+
+/*
+ * Work out why a committed frame did or did not scan the fullscreen client
+ * buffer out directly. The scene makes the actual decision; this only
+ * attributes the outcome so it can be counted.
+ */
+static enum flux_scanout_result classify_scanout(struct flux_output *output,
+		struct wlr_scene_output *scene_output, const struct wlr_output_state *state) {
+	struct flux_view *view = output->fullscreen_view;
+	if (!view) {
+		return FLUX_SCANOUT_NO_FULLSCREEN;
+	}
+	if (!view->mapped || view->minimized ||
+			view->minimizing_animation || view->restoring_animation) {
+		return FLUX_SCANOUT_VIEW_HIDDEN;
+	}
+
+	struct scanout_scan scan = {
+		.view = view,
+		.committed = (state->committed & WLR_OUTPUT_STATE_BUFFER) ? state->buffer : NULL,
+	};
+	wlr_scene_output_for_each_buffer(scene_output, scanout_scan_buffer, &scan);
+	if (scan.view_buffer_committed) {
+		return FLUX_SCANOUT_USED;
+	}
+
+	/* A drawn cursor is one scene buffer, so it lands in other_buffers too. */
+	if (scan.other_buffers > 0 || scan.view_buffers > 1) {
+		return FLUX_SCANOUT_OVERLAY;
+	}
+
+	struct wlr_output *wlr_output = output->wlr_output;
+	struct wlr_surface *surface = view->xdg_surface->surface;
+	if (view->xdg_geo_x != 0 || view->xdg_geo_y != 0 ||
+			surface->current.buffer_width != wlr_output->width ||
+			surface->current.buffer_height != wlr_output->height ||
+			surface->current.transform != wlr_output->transform) {
+		return FLUX_SCANOUT_GEOMETRY;
+	}
+	return FLUX_SCANOUT_REJECTED;
+}
+
+static void output_record_scanout(struct flux_output *output,
+		struct wlr_scene_output *scene_output, const struct wlr_output_state *state) {
+	enum flux_scanout_result result = classify_scanout(output, scene_output, state);
+	output->scanout_counts[result]++;
+	if (result != output->last_scanout_result) {
+		wlr_log(WLR_INFO, "output %s direct scanout: %s",
+			output->wlr_output->name, scanout_result_name(result));
+		output->last_scanout_result = result;
+	}
+}
+
+static bool buffer_is_single_pixel(struct wlr_buffer *buffer) {
+	if (wlr_single_pixel_buffer_v1_try_from_buffer(buffer)) {
+		return true;
+	}
+	/* Client buffers reach the scene wrapped; look at what the client attached. */
+	struct wlr_client_buffer *client_buffer = wlr_client_buffer_get(buffer);
+	return client_buffer && client_buffer->source &&
+		wlr_single_pixel_buffer_v1_try_from_buffer(client_buffer->source);
+}
+
+static void solid_scan_buffer(struct wlr_scene_buffer *buffer, int sx, int sy, void *data) {
+	(void)sx;
+	(void)sy;
+	bool *solid_only = data;
+	if (buffer->node.enabled && buffer->buffer && !buffer_is_single_pixel(buffer->buffer)) {
+		*solid_only = false;
+	}
+}
+
+/*
+ * A frame made only of rects and single-pixel buffers needs no texture
+ * sampling at all; counting them shows how often outputs get away with it.
+ */
+static void output_record_solid(struct flux_output *output,
+		struct wlr_scene_output *scene_output) {
+	bool solid_only = true;
+	wlr_scene_output_for_each_buffer(scene_output, solid_scan_buffer, &solid_only);
+	if (solid_only) {
+		output->frames_solid_only++;
+	}
+}
+
+/*
+ * Tearing is only offered to the client that owns the whole output: the
+ * focused fullscreen view, and only when it asked for async presentation.
+ */
+static bool output_wants_tearing(struct flux_output *output) {
+	struct flux_view *view = output->fullscreen_view;
+	if (!view || !view->mapped) {
+		return false;
+	}
+	struct flux_server *server = output->server;
+	struct wlr_surface *focused = server->seat->keyboard_state.focused_surface;
+	if (view_from_surface(server, focused) != view) {
+		return false;
+	}
+	return wlr_tearing_control_manager_v1_surface_hint_from_surface(
+		server->tearing_control_v1, view->xdg_surface->surface) ==
+		WP_TEARING_CONTROL_V1_PRESENTATION_HINT_ASYNC;
+}
+
+/*
+ * Returns whether the output accepted the frame. composited reports whether
+ * it carried a new buffer; cursor-only commits do not.
+ */
+static bool output_commit_frame(struct flux_output *output,
+		struct wlr_scene_output *scene_output, uint32_t now_msec, bool *composited) {
+	*composited = false;
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	if (!soft_compositor_build_state(output, scene_output, &state) &&
+			!wlr_scene_output_build_state(scene_output, &state, NULL)) {
+		wlr_output_state_finish(&state);
+		return false;
+	}
+
+	bool want_vrr = output->wlr_output->adaptive_sync_supported &&
+		output_wants_adaptive_sync(output, now_msec);
+	bool vrr_toggled = want_vrr != output->vrr_requested;
+	if (vrr_toggled) {
+		wlr_output_state_set_adaptive_sync_enabled(&state, want_vrr);
+	}
+
+	bool want_async = output_wants_tearing(output);
+	state.tearing_page_flip = want_async;
+	bool committed = wlr_output_commit_state(output->wlr_output, &state);
+	if (!committed && state.tearing_page_flip) {
+		/* Not every backend or plane setup can flip async; fall back to vsync. */
+		state.tearing_page_flip = false;
+		committed = wlr_output_commit_state(output->wlr_output, &state);
+	}
+	if (!committed && vrr_toggled) {
+		/* Never drop a frame because the backend refused the VRR change. */
+		state.committed &= ~WLR_OUTPUT_STATE_ADAPTIVE_SYNC_ENABLED;
+		committed = wlr_output_commit_state(output->wlr_output, &state);
+		if (committed) {
+			log_adaptive_sync_status(output, "backend rejected change");
+		}
+	} else if (committed && vrr_toggled) {
+		log_adaptive_sync_status(output,
+			want_vrr ? "client rendering" : "client idle");
+	}
+	/* Track what the backend applied, so a rejected change is tried again. */
+	output->vrr_requested = output->wlr_output->adaptive_sync_status ==
+		WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED;
+	if (committed) {
+		if (state.tearing_page_flip) {
+			output->frames_async++;
+		} else {
+			output->frames_vsync++;
+		}
+		if (want_async && !state.tearing_page_flip) {
+			output->async_fallbacks++;
+		}
+		if (state.tearing_page_flip != output->last_frame_async) {
+			wlr_log(WLR_INFO, "output %s presenting %s (async=%llu vsync=%llu fallbacks=%llu)",
+				output->wlr_output->name, state.tearing_page_flip ? "async" : "vsync",
+				(unsigned long long)output->frames_async,
+				(unsigned long long)output->frames_vsync,
+				(unsigned long long)output->async_fallbacks);
+			output->last_frame_async = state.tearing_page_flip;
+		}
+		output_record_scanout(output, scene_output, &state);
+		output_record_solid(output, scene_output);
+		if (state.committed & WLR_OUTPUT_STATE_BUFFER) {
+			mirror_source_committed(output, state.buffer);
+		}
+	}
+
+	*composited = committed && (state.committed & WLR_OUTPUT_STATE_BUFFER);
+	wlr_output_state_finish(&state);
+	return committed;
+}
+
+/* Headroom on top of the measured composite time so jitter does not miss vblank. */
+#define RENDER_DEADLINE_SLACK_NSEC 1000000ull
+
+/*
+ * Where this output shows the pointer: scene nodes composited with the
+ * frame, the hardware cursor plane, or wlroots' software cursor.
+ */
+static enum flux_cursor_path output_cursor_path(struct flux_output *output) {
+	if (output->server->cursor_tree) {
+		return FLUX_CURSOR_PATH_SCENE;
+	}
+	return output->wlr_output->hardware_cursor ?
+		FLUX_CURSOR_PATH_PLANE : FLUX_CURSOR_PATH_SOFTWARE;
+}
+
+static void output_update_cursor_path(struct flux_output *output) {
+	enum flux_cursor_path path = output_cursor_path(output);
+	if (path != output->cursor_path) {
+		wlr_log(WLR_INFO, "output %s cursor path: %s (composites avoided so far=%llu)",
+			output->wlr_output->name, cursor_path_name(path),
+			(unsigned long long)output->cursor_frames_avoided);
+		output->cursor_path = path;
+	}
+}
+
+static void output_repaint(struct flux_output *output) {
+	struct flux_server *server = output->server;
+	cursor_flush_motion(server);
+	bool pointer_moved = output->cursor_moved;
+	output->cursor_moved = false;
+	output_update_cursor_path(output);
 
 	struct wlr_scene_output *scene_output =
 		wlr_scene_get_scene_output(server->scene, output->wlr_output);
@@ -29,35 +370,455 @@ static void output_frame_notify(struct wl_listener *listener, void *data) {
 
 	struct timespec now;
 	clock_gettime(CLOCK_MONOTONIC, &now);
-	uint32_t now_msec = (uint32_t)(((uint64_t)now.tv_sec * 1000ull) +
-		((uint64_t)now.tv_nsec / 1000000ull));
+	uint64_t start_nsec = timespec_to_nsec(&now);
+	uint32_t now_msec = (uint32_t)(start_nsec / 1000000ull);
+	frame_stats_begin_frame(output, start_nsec);
 
-	update_output_background(output);
-	bool animating = view_tick_animations(server, now_msec);
-	taskbar_update(server);
+	bool animating = false;
+	if (server->animations_running) {
+		animating = view_tick_animations(server, now_msec);
+		server->animations_running = animating;
+	}
+	if (output->taskbar_dirty) {
+		taskbar_update_output(output);
+	}
+	hud_output_tick(output, now_msec);
+	damage_debug_tick(output, scene_output, now_msec);
+	pacing_output_repaint(output);
 
-	wlr_scene_output_commit(scene_output, NULL);
-	wlr_scene_output_send_frame_done(scene_output, &now);
+	bool composited = false;
+	if (wlr_scene_output_needs_frame(scene_output)) {
+		uint64_t commit_start_nsec = monotonic_nsec();
+		if (output_commit_frame(output, scene_output, now_msec, &composited)) {
+			frame_histogram_record(&output->stats.commit,
+				monotonic_nsec() - commit_start_nsec);
+			output->stats.last_frame_committed = true;
+			output->frames_rendered++;
+			output->last_commit_nsec = start_nsec;
+		} else {
+			output->frames_failed++;
+		}
+	} else {
+		output->frames_skipped++;
+	}
+	/* On the plane a move only repositions the cursor; the scene path recomposites. */
+	if (pointer_moved && !composited && output->cursor_path == FLUX_CURSOR_PATH_PLANE) {
+		output->cursor_frames_avoided++;
+	}
+
+	/* Stamp frame callbacks after the commit so clients see when work finished. */
+	frame_done_send(output, scene_output, monotonic_nsec());
+	uint64_t done_nsec = monotonic_nsec();
+	frame_histogram_record(&output->stats.callback, done_nsec - start_nsec);
+	if (output->stats.last_frame_committed) {
+		/* EWMA with 1/8 weight: follows load changes within a few frames. */
+		uint64_t sample = done_nsec - start_nsec;
+		output->render_ewma_nsec = output->render_ewma_nsec == 0 ? sample :
+			(output->render_ewma_nsec * 7 + sample) / 8;
+	}
 
 	if (animating) {
-		struct flux_output *iter;
-		wl_list_for_each(iter, &server->outputs, link) {
-			wlr_output_schedule_frame(iter->wlr_output);
+		view_schedule_animation_frames(server, output);
+	}
+}
+
+static int output_repaint_timer_notify(void *data) {
+	struct flux_output *output = data;
+	output->repaint_pending = false;
+	output_repaint(output);
+	return 0;
+}
+
+/* With adaptive sync or tearing the flip follows our commit, not a vblank. */
+bool output_has_fixed_refresh(struct flux_output *output) {
+	return output->wlr_output->adaptive_sync_status != WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED &&
+		!output_wants_tearing(output);
+}
+
+/* Nearest-neighbour is a plain copy for pixman; bilinear samples four texels. */
+enum wlr_scale_filter_mode render_profile_scale_filter(struct flux_server *server) {
+	return server->render_profile == FLUX_RENDER_PROFILE_LOW_POWER ?
+		WLR_SCALE_FILTER_NEAREST : WLR_SCALE_FILTER_BILINEAR;
+}
+
+/* Time reserved before vblank for compositing, or 0 without a render deadline. */
+uint64_t output_render_budget_nsec(struct flux_output *output) {
+	if (output->max_render_time_msec == 0 || output->last_present_nsec == 0 ||
+			!output_has_fixed_refresh(output)) {
+		return 0;
+	}
+
+	uint64_t budget = output->render_ewma_nsec + RENDER_DEADLINE_SLACK_NSEC;
+	if (output->max_render_time_msec > 0) {
+		uint64_t configured = (uint64_t)output->max_render_time_msec * 1000000ull;
+		if (configured > budget) {
+			budget = configured;
 		}
 	}
+	return budget;
+}
+
+/*
+ * How long to hold composition after the frame event so that input and
+ * client commits arriving late in the refresh cycle still make this vblank.
+ */
+static int output_repaint_delay_msec(struct flux_output *output, uint64_t now_nsec) {
+	uint64_t budget = output_render_budget_nsec(output);
+	uint64_t refresh = output_refresh_nsec(output);
+	if (budget == 0 || refresh == 0) {
+		return 0;
+	}
+
+	uint64_t next_vblank = output_predict_present_nsec(output, now_nsec);
+	if (budget >= refresh || next_vblank - now_nsec <= budget) {
+		return 0;
+	}
+
+	return (int)((next_vblank - budget - now_nsec) / 1000000ull);
+}
+
+/* Time left before the low-power frame cap allows the next composite. */
+static int output_frame_cap_delay_msec(struct flux_output *output, uint64_t now_nsec) {
+	if (output->frame_cap_nsec == 0 || output->last_commit_nsec == 0) {
+		return 0;
+	}
+	uint64_t next_nsec = output->last_commit_nsec + output->frame_cap_nsec;
+	if (next_nsec <= now_nsec) {
+		return 0;
+	}
+	/* Round up: a timer firing just short of the cap would only re-arm. */
+	return (int)((next_nsec - now_nsec + 999999ull) / 1000000ull);
+}
+
+static void output_frame_notify(struct wl_listener *listener, void *data) {
+	(void)data;
+	struct flux_output *output = wl_container_of(listener, output, frame);
+	if (!output->wlr_output->enabled) {
+		return;
+	}
+	if (output_is_mirror(output)) {
+		mirror_repaint(output);
+		return;
+	}
+	if (output->repaint_pending) {
+		return;
+	}
+
+	uint64_t now_nsec = monotonic_nsec();
+	int delay_msec = output_repaint_delay_msec(output, now_nsec);
+	int cap_msec = output_frame_cap_delay_msec(output, now_nsec);
+	if (cap_msec > delay_msec && output->repaint_timer) {
+		output->repaint_pending = true;
+		output->frames_capped++;
+		wl_event_source_timer_update(output->repaint_timer, cap_msec);
+		return;
+	}
+	if (delay_msec > 0 && output->repaint_timer) {
+		output->repaint_pending = true;
+		output->frames_delayed++;
+		wl_event_source_timer_update(output->repaint_timer, delay_msec);
+		return;
+	}
+	output_repaint(output);
+}
+
+#define MODE_CANDIDATES_MAX 64
+
+static const char *mode_policy_name(enum flux_mode_policy policy) {
+	switch (policy) {
+	case FLUX_MODE_HIGHEST_REFRESH:
+		return "highest-refresh";
+	case FLUX_MODE_LOW_POWER:
+		return "low-power";
+	case FLUX_MODE_EXPLICIT:
+		return "explicit";
+	case FLUX_MODE_PREFERRED:
+	default:
+		return "preferred";
+	}
+}
+
+/* The native resolution is the preferred mode's, or the largest advertised. */
+static struct wlr_output_mode *native_mode(struct wlr_output *wlr_output) {
+	struct wlr_output_mode *preferred = wlr_output_preferred_mode(wlr_output);
+	if (preferred) {
+		return preferred;
+	}
+	struct wlr_output_mode *best = NULL;
+	struct wlr_output_mode *mode;
+	wl_list_for_each(mode, &wlr_output->modes, link) {
+		if (!best || (int64_t)mode->width * mode->height >
+				(int64_t)best->width * best->height) {
+			best = mode;
+		}
+	}
+	return best;
+}
+
+static int32_t refresh_distance(const struct wlr_output_mode *mode, int32_t refresh_mhz) {
+	int32_t diff = mode->refresh - refresh_mhz;
+	return diff < 0 ? -diff : diff;
+}
+
+static bool mode_sorts_before(const struct wlr_output_mode *lhs,
+		const struct wlr_output_mode *rhs, enum flux_mode_policy policy,
+		int32_t refresh_mhz) {
+	switch (policy) {
+	case FLUX_MODE_HIGHEST_REFRESH:
+		return lhs->refresh > rhs->refresh;
+	case FLUX_MODE_LOW_POWER:
+		return lhs->refresh < rhs->refresh;
+	case FLUX_MODE_EXPLICIT:
+	default:
+		return refresh_distance(lhs, refresh_mhz) < refresh_distance(rhs, refresh_mhz);
+	}
+}
+
+/*
+ * Order the advertised modes by how well they fit the request. The preferred
+ * mode is always appended so a failed pick degrades to the old behaviour.
+ */
+static size_t collect_mode_candidates(struct wlr_output *wlr_output,
+		const struct flux_mode_request *request,
+		struct wlr_output_mode **out, size_t max) {
+	size_t count = 0;
+	struct wlr_output_mode *preferred = wlr_output_preferred_mode(wlr_output);
+	struct wlr_output_mode *native = native_mode(wlr_output);
+
+	if (request->policy != FLUX_MODE_PREFERRED && native) {
+		int32_t want_w = request->policy == FLUX_MODE_EXPLICIT ?
+			request->width : native->width;
+		int32_t want_h = request->policy == FLUX_MODE_EXPLICIT ?
+			request->height : native->height;
+
+		struct wlr_output_mode *mode;
+		wl_list_for_each(mode, &wlr_output->modes, link) {
+			if (count < max && mode->width == want_w && mode->height == want_h) {
+				out[count++] = mode;
+			}
+		}
+		/* Explicit requests without a refresh rate take the fastest match. */
+		enum flux_mode_policy order = request->policy;
+		if (order == FLUX_MODE_EXPLICIT && request->refresh_mhz == 0) {
+			order = FLUX_MODE_HIGHEST_REFRESH;
+		}
+		for (size_t i = 1; i < count; i++) {
+			struct wlr_output_mode *key = out[i];
+			size_t j = i;
+			while (j > 0 && mode_sorts_before(key, out[j - 1], order,
+					request->refresh_mhz)) {
+				out[j] = out[j - 1];
+				j--;
+			}
+			out[j] = key;
+		}
+	}
+
+	if (preferred && count < max) {
+		bool seen = false;
+		for (size_t i = 0; i < count; i++) {
+			seen = seen || out[i] == preferred;
+		}
+		if (!seen) {
+			out[count++] = preferred;
+		}
+	}
+	return count;
+}
+
+static bool output_try_mode(struct wlr_output *wlr_output,
+		struct wlr_output_mode *mode, const struct flux_mode_request *custom,
+		bool adaptive_sync) {
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	wlr_output_state_set_enabled(&state, true);
+	if (mode) {
+		wlr_output_state_set_mode(&state, mode);
+	} else if (custom) {
+		wlr_output_state_set_custom_mode(&state,
+			custom->width, custom->height, custom->refresh_mhz);
+	}
+	if (adaptive_sync) {
+		wlr_output_state_set_adaptive_sync_enabled(&state, true);
+	}
+
+	bool ok = wlr_output_test_state(wlr_output, &state);
+	if (!ok && adaptive_sync) {
+		state.committed &= ~WLR_OUTPUT_STATE_ADAPTIVE_SYNC_ENABLED;
+		ok = wlr_output_test_state(wlr_output, &state);
+	}
+	ok = ok && wlr_output_commit_state(wlr_output, &state);
+	wlr_output_state_finish(&state);
+	return ok;
+}
+
+static bool apply_mode_request(struct wlr_output *wlr_output,
+		const struct flux_mode_request *request, bool adaptive_sync) {
+	struct wlr_output_mode *candidates[MODE_CANDIDATES_MAX];
+	size_t count = collect_mode_candidates(wlr_output, request,
+		candidates, MODE_CANDIDATES_MAX);
+
+	for (size_t i = 0; i < count; i++) {
+		if (output_try_mode(wlr_output, candidates[i], NULL, adaptive_sync)) {
+			wlr_log(WLR_INFO, "output %s mode %dx%d@%.3fHz (policy %s%s)",
+				wlr_output->name, candidates[i]->width, candidates[i]->height,
+				candidates[i]->refresh / 1000.0, mode_policy_name(request->policy),
+				i > 0 ? ", fallback" : "");
+			return true;
+		}
+		wlr_log(WLR_INFO, "output %s rejected mode %dx%d@%.3fHz",
+			wlr_output->name, candidates[i]->width, candidates[i]->height,
+			candidates[i]->refresh / 1000.0);
+	}
+
+	/* Nested and headless backends advertise no modes but take custom ones. */
+	if (wl_list_empty(&wlr_output->modes) && request->policy == FLUX_MODE_EXPLICIT &&
+			output_try_mode(wlr_output, NULL, request, adaptive_sync)) {
+		wlr_log(WLR_INFO, "output %s custom mode %dx%d", wlr_output->name,
+			request->width, request->height);
+		return true;
+	}
+	if (count == 0 && output_try_mode(wlr_output, NULL, NULL, adaptive_sync)) {
+		return true;
+	}
+	return false;
+}
+
+bool output_apply_mode_request(struct flux_output *output,
+		const struct flux_mode_request *request) {
+	if (!apply_mode_request(output->wlr_output, request, output->vrr_requested)) {
+		wlr_log(WLR_ERROR, "output %s: no usable mode for policy %s",
+			output->wlr_output->name, mode_policy_name(request->policy));
+		return false;
+	}
+
+	output->mode_request = *request;
+	/* The old refresh period no longer applies; wait for fresh feedback. */
+	output->present_refresh_nsec = 0;
+	output->last_present_nsec = 0;
+	output->stats.last_frame_committed = false;
+	output->vrr_requested = output->wlr_output->adaptive_sync_status ==
+		WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED;
+	if (output->fullscreen_view) {
+		view_set_fullscreen(output->fullscreen_view, true, output->wlr_output);
+	}
+	wlr_output_schedule_frame(output->wlr_output);
+	return true;
+}
+
+bool output_set_power(struct flux_output *output, bool on) {
+	struct wlr_output *wlr_output = output->wlr_output;
+	if (wlr_output->enabled == on) {
+		return true;
+	}
+
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	wlr_output_state_set_enabled(&state, on);
+	bool ok = wlr_output_commit_state(wlr_output, &state);
+	wlr_output_state_finish(&state);
+	if (!ok && on) {
+		/* The previous mode may be gone after a long sleep; pick again. */
+		ok = apply_mode_request(wlr_output, &output->mode_request, output->vrr_requested);
+	}
+	if (!ok) {
+		wlr_log(WLR_ERROR, "output %s: failed to power %s",
+			wlr_output->name, on ? "on" : "off");
+		return false;
+	}
+
+	if (!on) {
+		if (output->repaint_pending) {
+			wl_event_source_timer_update(output->repaint_timer, 0);
+			output->repaint_pending = false;
+		}
+		frame_done_output_finish(output);
+		mirror_release(output);
+	} else {
+		output->last_present_nsec = 0;
+		output->stats.last_frame_committed = false;
+		wlr_output_schedule_frame(wlr_output);
+	}
+	mirror_update_cursors(output->server);
+	pacing_outputs_changed(output->server);
+	return true;
+}
+
+void output_toggle_refresh_policy(struct flux_server *server) {
+	struct wlr_output *wlr_output = wlr_output_layout_output_at(server->output_layout,
+		server->cursor->x, server->cursor->y);
+
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->wlr_output != wlr_output) {
+			continue;
+		}
+		struct flux_mode_request request = {
+			.policy = output->mode_request.policy == FLUX_MODE_HIGHEST_REFRESH ?
+				FLUX_MODE_LOW_POWER : FLUX_MODE_HIGHEST_REFRESH,
+		};
+		output_apply_mode_request(output, &request);
+		return;
+	}
+}
+
+static void output_present_notify(struct wl_listener *listener, void *data) {
+	struct flux_output *output = wl_container_of(listener, output, present);
+	struct wlr_output_event_present *event = data;
+	if (!event->presented) {
+		return;
+	}
+
+	output->last_present_nsec = timespec_to_nsec(&event->when);
+	uint64_t refresh_nsec = event->refresh > 0 ? (uint64_t)event->refresh : 0;
+	if (refresh_nsec != output->present_refresh_nsec ||
+			event->flags != output->present_flags) {
+		wlr_log(WLR_INFO,
+			"output %s presentation: refresh=%.3fms vsync=%d hw_clock=%d hw_completion=%d zero_copy=%d",
+			output->wlr_output->name, refresh_nsec / 1000000.0,
+			(event->flags & WLR_OUTPUT_PRESENT_VSYNC) != 0,
+			(event->flags & WLR_OUTPUT_PRESENT_HW_CLOCK) != 0,
+			(event->flags & WLR_OUTPUT_PRESENT_HW_COMPLETION) != 0,
+			(event->flags & WLR_OUTPUT_PRESENT_ZERO_COPY) != 0);
+	}
+	output->present_refresh_nsec = refresh_nsec;
+	output->present_flags = event->flags;
 }
 
 static void output_destroy_notify(struct wl_listener *listener, void *data) {
 	(void)data;
 	struct flux_output *output = wl_container_of(listener, output, destroy);
+	if (output->fullscreen_view) {
+		view_set_fullscreen(output->fullscreen_view, false, NULL);
+	}
+	frame_stats_log_output(output);
+	wallpaper_output_destroy(output);
 	if (output->background_rect) {
 		wlr_scene_node_destroy(&output->background_rect->node);
 		output->background_rect = NULL;
 	}
+	taskbar_output_destroy(output);
 	taskbar_mark_dirty(output->server);
+	damage_debug_output_destroy(output);
+	hud_output_destroy(output);
+	if (output->repaint_timer) {
+		wl_event_source_remove(output->repaint_timer);
+	}
+	frame_done_output_finish(output);
+	if (output->frame_done_timer) {
+		wl_event_source_remove(output->frame_done_timer);
+	}
+	mirror_release(output);
+	soft_compositor_output_destroy(output);
 	wl_list_remove(&output->frame.link);
+	wl_list_remove(&output->present.link);
 	wl_list_remove(&output->destroy.link);
 	wl_list_remove(&output->link);
+	if (output->server->motion_output == output->wlr_output) {
+		output->server->motion_output = NULL;
+	}
+	mirror_update_cursors(output->server);
+	pacing_outputs_changed(output->server);
 	free(output);
 }
 
@@ -70,30 +831,69 @@ void new_output_notify(struct wl_listener *listener, void *data) {
 		return;
 	}
 
-	struct wlr_output_mode *mode = wlr_output_preferred_mode(wlr_output);
-	struct wlr_output_state state;
-	wlr_output_state_init(&state);
-	wlr_output_state_set_enabled(&state, true);
-	if (mode) {
-		wlr_output_state_set_mode(&state, mode);
-	}
-	if (!wlr_output_commit_state(wlr_output, &state)) {
-		wlr_output_state_finish(&state);
+	enum flux_vrr_mode vrr_mode = parse_vrr_mode(wlr_output->name);
+	bool vrr_at_start = vrr_mode == FLUX_VRR_ON && wlr_output->adaptive_sync_supported;
+
+	struct flux_mode_request mode_request;
+	parse_output_mode(wlr_output->name, &mode_request);
+	if (!apply_mode_request(wlr_output, &mode_request, vrr_at_start)) {
 		wlr_log(WLR_ERROR, "output commit failed");
 		return;
 	}
-	wlr_output_state_finish(&state);
-
-	wlr_output_layout_add_auto(server->output_layout, wlr_output);
-	wlr_scene_output_create(server->scene, wlr_output);
-	taskbar_mark_dirty(server);
+	vrr_at_start = wlr_output->adaptive_sync_status == WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED;
 
 	struct flux_output *output = calloc(1, sizeof(*output));
 	output->server = server;
 	output->wlr_output = wlr_output;
-	output->background_rect =
-		wlr_scene_rect_create(&server->scene->tree, 1, 1, COLOR_BACKGROUND);
-	update_output_background(output);
+
+	/* Mirrors stay out of the layout and scene; they only copy their source. */
+	bool mirror = parse_mirror_source(wlr_output->name,
+		output->mirror_of, sizeof(output->mirror_of));
+	if (mirror) {
+		wlr_log(WLR_INFO, "output %s mirrors %s", wlr_output->name, output->mirror_of);
+	} else {
+		wlr_output_layout_add_auto(server->output_layout, wlr_output);
+		wlr_scene_output_create(server->scene, wlr_output);
+	}
+	taskbar_mark_dirty(server);
+
+	output->mode_request = mode_request;
+	output->vrr_mode = vrr_mode;
+	output->last_scanout_result = FLUX_SCANOUT_NO_FULLSCREEN;
+	output->vrr_requested = vrr_at_start;
+	output->max_render_time_msec = mirror ? 0 : parse_max_render_time(wlr_output->name);
+	if (!mirror && server->render_profile == FLUX_RENDER_PROFILE_LOW_POWER) {
+		int fps = parse_low_power_fps(wlr_output->name);
+		output->frame_cap_nsec = fps > 0 ? 1000000000ull / (uint64_t)fps : 0;
+		if (fps > 0) {
+			wlr_log(WLR_INFO, "output %s low-power frame cap %d fps", wlr_output->name, fps);
+		} else {
+			wlr_log(WLR_INFO, "output %s low-power frame cap off", wlr_output->name);
+		}
+	}
+	if (output->max_render_time_msec != 0 || output->frame_cap_nsec != 0) {
+		output->repaint_timer = wl_event_loop_add_timer(
+			wl_display_get_event_loop(server->display),
+			output_repaint_timer_notify, output);
+		if (output->max_render_time_msec > 0) {
+			wlr_log(WLR_INFO, "output %s max render time %dms",
+				wlr_output->name, output->max_render_time_msec);
+		} else if (output->max_render_time_msec < 0) {
+			wlr_log(WLR_INFO, "output %s max render time auto", wlr_output->name);
+		}
+	}
+	if (!mirror) {
+		frame_done_output_init(output);
+	}
+	if (vrr_mode != FLUX_VRR_OFF) {
+		log_adaptive_sync_status(output, "output enabled");
+	}
+	if (!mirror) {
+		output->background_rect =
+			wlr_scene_rect_create(&server->scene->tree, 1, 1, COLOR_BACKGROUND);
+		update_output_background(output);
+		taskbar_output_init(output);
+	}
 
 	if (server->xcursor_manager) {
 		wlr_xcursor_manager_load(server->xcursor_manager, wlr_output->scale);
@@ -114,21 +914,16 @@ void new_output_notify(struct wl_listener *listener, void *data) {
 
 	output->frame.notify = output_frame_notify;
 	wl_signal_add(&wlr_output->events.frame, &output->frame);
+	output->present.notify = output_present_notify;
+	wl_signal_add(&wlr_output->events.present, &output->present);
 	output->destroy.notify = output_destroy_notify;
 	wl_signal_add(&wlr_output->events.destroy, &output->destroy);
 
 	wl_list_insert(&server->outputs, &output->link);
+	mirror_update_cursors(server);
+	idle_output_added(output);
 
 	if (server->use_drawn_cursor) {
-		if (server->cursor_tree) {
-			wlr_scene_node_destroy(&server->cursor_tree->node);
-			server->cursor_tree = NULL;
-		}
-		create_cursor_pointer(server);
-		if (server->cursor_tree) {
-			wlr_scene_node_set_position(&server->cursor_tree->node,
-				(int)server->cursor_x - server->cursor_hotspot_x,
-				(int)server->cursor_y - server->cursor_hotspot_y);
-		}
+		cursor_reload_custom(server);
 	}
 }
@@ -0,0 +1,144 @@
+#include "flux.h"
+
+#define FIFO_MANAGER_VERSION 1
+#define COMMIT_TIMING_MANAGER_VERSION 1
+
+/*
+ * wlroots holds back fifo and commit-timer commits itself; it only needs to
+ * know which output refreshes each surface. One of these follows every
+ * wp_fifo_v1 and wp_commit_timer_v1 and keeps that output pointed at a live
+ * output the surface is on, or NULL when there is none.
+ */
+struct flux_paced_surface {
+	struct wl_list link; // flux_server::paced_surfaces
+	struct flux_server *server;
+	struct wlr_surface *surface;
+	/* Exactly one of these is set. */
+	struct wlr_fifo_v1 *fifo;
+	struct wlr_commit_timing_v1 *timer;
+	struct wlr_output *output;
+	struct wl_listener destroy;
+};
+
+/* Powered and still known to Flux, so its frame events will keep coming. */
+static bool output_is_live(struct flux_server *server, struct wlr_output *wlr_output) {
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->wlr_output == wlr_output) {
+			return wlr_output->enabled;
+		}
+	}
+	return false;
+}
+
+static void paced_surface_set_output(struct flux_paced_surface *paced,
+		struct wlr_output *wlr_output) {
+	if (paced->output == wlr_output) {
+		return;
+	}
+	paced->output = wlr_output;
+	if (paced->fifo) {
+		wlr_fifo_v1_set_output(paced->fifo, wlr_output);
+	} else {
+		wlr_commit_timing_v1_set_output(paced->timer, wlr_output);
+	}
+}
+
+/* Keeps the current output while it still shows the surface. */
+static void paced_surface_update_output(struct flux_paced_surface *paced) {
+	struct flux_server *server = paced->server;
+	struct wlr_output *first = NULL;
+	struct wlr_surface_output *surface_output;
+	wl_list_for_each(surface_output, &paced->surface->current_outputs, link) {
+		if (!output_is_live(server, surface_output->output)) {
+			continue;
+		}
+		if (surface_output->output == paced->output) {
+			return;
+		}
+		first = first ? first : surface_output->output;
+	}
+	paced_surface_set_output(paced, first);
+}
+
+static void paced_surface_destroy_notify(struct wl_listener *listener, void *data) {
+	(void)data;
+	struct flux_paced_surface *paced = wl_container_of(listener, paced, destroy);
+	wl_list_remove(&paced->destroy.link);
+	wl_list_remove(&paced->link);
+	free(paced);
+}
+
+static struct flux_paced_surface *paced_surface_create(struct flux_server *server,
+		struct wlr_surface *surface, struct wl_signal *destroy) {
+	struct flux_paced_surface *paced = calloc(1, sizeof(*paced));
+	if (!paced) {
+		wlr_log(WLR_ERROR, "pacing: out of memory tracking a surface");
+		return NULL;
+	}
+	paced->server = server;
+	paced->surface = surface;
+	paced->destroy.notify = paced_surface_destroy_notify;
+	wl_signal_add(destroy, &paced->destroy);
+	wl_list_insert(&server->paced_surfaces, &paced->link);
+	return paced;
+}
+
+static void new_fifo_notify(struct wl_listener *listener, void *data) {
+	struct flux_server *server = wl_container_of(listener, server, new_fifo);
+	struct wlr_fifo_manager_v1_new_fifo_event *event = data;
+	struct flux_paced_surface *paced = paced_surface_create(server,
+		event->fifo->surface, &event->fifo->events.destroy);
+	if (paced) {
+		paced->fifo = event->fifo;
+		paced_surface_update_output(paced);
+	}
+}
+
+static void new_commit_timer_notify(struct wl_listener *listener, void *data) {
+	struct flux_server *server = wl_container_of(listener, server, new_commit_timer);
+	struct wlr_commit_timing_manager_v1_new_timer_event *event = data;
+	struct flux_paced_surface *paced = paced_surface_create(server,
+		event->timer->surface, &event->timer->events.destroy);
+	if (paced) {
+		paced->timer = event->timer;
+		paced_surface_update_output(paced);
+	}
+}
+
+/*
+ * Runs before each repaint, so a surface that moved onto this output has its
+ * barriers and target times resolved against the refresh that will show it.
+ */
+void pacing_output_repaint(struct flux_output *output) {
+	struct flux_paced_surface *paced;
+	wl_list_for_each(paced, &output->server->paced_surfaces, link) {
+		if (paced->output != output->wlr_output) {
+			paced_surface_update_output(paced);
+		}
+	}
+}
+
+/* Outputs were powered off, on, or removed: repoint surfaces at what is left. */
+void pacing_outputs_changed(struct flux_server *server) {
+	struct flux_paced_surface *paced;
+	wl_list_for_each(paced, &server->paced_surfaces, link) {
+		paced_surface_update_output(paced);
+	}
+}
+
+bool pacing_init(struct flux_server *server) {
+	server->fifo_manager = wlr_fifo_manager_v1_create(server->display,
+		FIFO_MANAGER_VERSION);
+	server->commit_timing_manager = wlr_commit_timing_manager_v1_create(server->display,
+		COMMIT_TIMING_MANAGER_VERSION);
+	if (!server->fifo_manager || !server->commit_timing_manager) {
+		return false;
+	}
+	server->new_fifo.notify = new_fifo_notify;
+	wl_signal_add(&server->fifo_manager->events.new_fifo, &server->new_fifo);
+	server->new_commit_timer.notify = new_commit_timer_notify;
+	wl_signal_add(&server->commit_timing_manager->events.new_timer,
+		&server->new_commit_timer);
+	return true;
+}
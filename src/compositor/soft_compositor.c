@@ -0,0 +1,759 @@
+#include "flux.h"
+
+#include <drm_fourcc.h>
+#include <pixman.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <wlr/render/pixman.h>
+#include <wlr/render/swapchain.h>
+#include <wlr/types/wlr_damage_ring.h>
+#include <wlr/util/box.h>
+
+/*
+ * Tiled software compositor for the pixman renderer. Instead of letting the
+ * scene render through pixman on the main thread, the visible scene is turned
+ * into a flat list of fill/copy/blend ops, the repaint region is cut into
+ * tiles, and the tiles are composited in parallel straight into the output
+ * buffer. Frames containing anything the kernels cannot reproduce exactly
+ * (scaling, transforms, opacity, other formats, software cursors) go through
+ * wlr_scene_output_build_state as before; both paths share the scene output's
+ * damage ring and the output swapchain, so they can alternate per frame.
+ *
+ * The main thread takes a data-ptr access on every source buffer, client shm
+ * included, before the workers start and ends it once they are done, the way
+ * the pixman renderer brackets its own reads. Workers only read inside that
+ * window. As with the pixman renderer, a client that truncates its pool
+ * mid-frame is not recovered from.
+ */
+
+#define SOFT_TILE_SIZE 128
+#define SOFT_MAX_THREADS 16
+#define SOFT_BACKGROUND 0xff000000u
+
+enum soft_op_type {
+	SOFT_OP_FILL,
+	SOFT_OP_COPY,
+	SOFT_OP_BLEND,
+};
+
+struct soft_op {
+	enum soft_op_type type;
+	struct wlr_box box; // output buffer coordinates, clipped to the buffer
+	bool blend; // SOFT_OP_FILL: OVER instead of SRC
+	uint32_t color; // SOFT_OP_FILL
+	const uint32_t *src; // source pixel at box.x, box.y
+	size_t src_stride;
+	uint32_t or_mask; // SOFT_OP_COPY: forces alpha for X formats
+	struct wlr_scene_buffer *scene_buffer; // told it was sampled once drawn
+};
+
+struct soft_source {
+	struct wlr_buffer *buffer;
+	void *data;
+	uint32_t format;
+	size_t stride;
+	struct wlr_buffer *accessed; // data-ptr access to end after the frame
+};
+
+struct soft_frame {
+	struct soft_op *ops;
+	size_t op_count;
+	size_t op_cap;
+	struct soft_source *sources;
+	size_t source_count;
+	size_t source_cap;
+	struct wlr_box *tiles;
+	size_t tile_count;
+	size_t tile_cap;
+
+	uint32_t *dst;
+	size_t dst_stride;
+	int width;
+	int height;
+	const pixman_region32_t *repaint;
+};
+
+struct flux_soft_compositor {
+	struct flux_server *server;
+	const struct soft_kernels *kernels;
+	bool verify;
+
+	pthread_t threads[SOFT_MAX_THREADS];
+	int thread_count;
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	uint64_t generation;
+	int workers_busy;
+	bool stopping;
+
+	struct soft_frame frame;
+	atomic_size_t next_tile;
+};
+
+static bool grow(void **array, size_t *cap, size_t need, size_t elem_size) {
+	if (need <= *cap) {
+		return true;
+	}
+	size_t new_cap = *cap ? *cap * 2 : 64;
+	while (new_cap < need) {
+		new_cap *= 2;
+	}
+	void *grown = realloc(*array, new_cap * elem_size);
+	if (!grown) {
+		return false;
+	}
+	*array = grown;
+	*cap = new_cap;
+	return true;
+}
+
+/* Same narrowing as the pixman renderer: float -> 16 bit -> top 8 bits. */
+static uint32_t rect_channel(float value) {
+	if (value <= 0.0f) {
+		return 0;
+	}
+	if (value >= 1.0f) {
+		return 0xff;
+	}
+	return (uint32_t)((uint16_t)(value * 0xFFFF) >> 8);
+}
+
+static uint32_t rect_pixel(const float color[4]) {
+	return rect_channel(color[3]) << 24 | rect_channel(color[0]) << 16 |
+		rect_channel(color[1]) << 8 | rect_channel(color[2]);
+}
+
+static bool frame_add_op(struct soft_frame *frame, const struct soft_op *op) {
+	if (!grow((void **)&frame->ops, &frame->op_cap, frame->op_count + 1, sizeof(*op))) {
+		return false;
+	}
+	frame->ops[frame->op_count++] = *op;
+	return true;
+}
+
+static void frame_release_sources(struct soft_frame *frame) {
+	for (size_t i = 0; i < frame->source_count; i++) {
+		if (frame->sources[i].accessed) {
+			wlr_buffer_end_data_ptr_access(frame->sources[i].accessed);
+		}
+	}
+	frame->source_count = 0;
+}
+
+static struct soft_source *frame_source(struct soft_frame *frame, struct wlr_buffer *buffer) {
+	for (size_t i = 0; i < frame->source_count; i++) {
+		if (frame->sources[i].buffer == buffer) {
+			return &frame->sources[i];
+		}
+	}
+	if (!grow((void **)&frame->sources, &frame->source_cap,
+			frame->source_count + 1, sizeof(*frame->sources))) {
+		return NULL;
+	}
+	struct soft_source *source = &frame->sources[frame->source_count];
+	source->buffer = buffer;
+	source->accessed = NULL;
+	/*
+	 * Client surfaces are wrapped in a wlr_client_buffer with no CPU access of
+	 * its own; the client's shm buffer behind it is what holds the pixels.
+	 */
+	struct wlr_client_buffer *client_buffer = wlr_client_buffer_get(buffer);
+	struct wlr_buffer *pixels = client_buffer && client_buffer->source ?
+		client_buffer->source : buffer;
+	if (wlr_buffer_begin_data_ptr_access(pixels, WLR_BUFFER_DATA_PTR_ACCESS_READ,
+			&source->data, &source->format, &source->stride)) {
+		source->accessed = pixels;
+	} else {
+		/* Otherwise the pixman texture maps them. */
+		if (!client_buffer || !client_buffer->texture ||
+				!wlr_texture_is_pixman(client_buffer->texture)) {
+			return NULL;
+		}
+		pixman_image_t *image = wlr_pixman_texture_get_image(client_buffer->texture);
+		switch (pixman_image_get_format(image)) {
+		case PIXMAN_a8r8g8b8:
+			source->format = DRM_FORMAT_ARGB8888;
+			break;
+		case PIXMAN_x8r8g8b8:
+			source->format = DRM_FORMAT_XRGB8888;
+			break;
+		default:
+			source->format = DRM_FORMAT_INVALID;
+			break;
+		}
+		source->data = pixman_image_get_data(image);
+		source->stride = (size_t)pixman_image_get_stride(image);
+		if (!source->data || pixman_image_get_width(image) != buffer->width ||
+				pixman_image_get_height(image) != buffer->height) {
+			return NULL;
+		}
+	}
+	frame->source_count++;
+	return source;
+}
+
+/* part lies inside box, the buffer's full extent in output coordinates. */
+static bool frame_add_source_op(struct soft_frame *frame, enum soft_op_type type,
+		const struct wlr_box *part, const struct soft_source *source,
+		const struct wlr_box *box, uint32_t or_mask, struct wlr_scene_buffer *scene_buffer) {
+	const uint8_t *origin = (const uint8_t *)source->data +
+		(size_t)(part->y - box->y) * source->stride + (size_t)(part->x - box->x) * 4;
+	struct soft_op op = {
+		.type = type,
+		.box = *part,
+		.src = (const uint32_t *)origin,
+		.src_stride = source->stride / 4,
+		.or_mask = or_mask,
+		.scene_buffer = scene_buffer,
+	};
+	return frame_add_op(frame, &op);
+}
+
+struct soft_build {
+	struct soft_frame *frame;
+	struct wlr_scene_output *scene_output;
+	const char *reject;
+};
+
+static bool clip_to_output(struct soft_build *build, struct wlr_box *box) {
+	struct wlr_box output_box = {
+		.width = build->frame->width,
+		.height = build->frame->height,
+	};
+	return wlr_box_intersection(box, box, &output_box);
+}
+
+static bool build_rect(struct soft_build *build, struct wlr_scene_rect *rect, int lx, int ly) {
+	struct soft_op op = {
+		.type = SOFT_OP_FILL,
+		.box = {
+			.x = lx - build->scene_output->x,
+			.y = ly - build->scene_output->y,
+			.width = rect->width,
+			.height = rect->height,
+		},
+		.color = rect_pixel(rect->color),
+	};
+	if (!clip_to_output(build, &op.box)) {
+		return true;
+	}
+	op.blend = (op.color >> 24) != 0xff;
+	return frame_add_op(build->frame, &op);
+}
+
+static bool build_buffer(struct soft_build *build, struct wlr_scene_buffer *scene_buffer,
+		int lx, int ly) {
+	struct wlr_buffer *buffer = scene_buffer->buffer;
+	if (!buffer) {
+		return true;
+	}
+	if (scene_buffer->transform != WL_OUTPUT_TRANSFORM_NORMAL ||
+			scene_buffer->opacity != 1.0f ||
+			(scene_buffer->dst_width != 0 && scene_buffer->dst_width != buffer->width) ||
+			(scene_buffer->dst_height != 0 && scene_buffer->dst_height != buffer->height)) {
+		build->reject = "scaled or transformed buffer";
+		return false;
+	}
+	const struct wlr_fbox *src = &scene_buffer->src_box;
+	if (!wlr_fbox_empty(src) && (src->x != 0.0 || src->y != 0.0 ||
+			src->width != buffer->width || src->height != buffer->height)) {
+		build->reject = "cropped buffer";
+		return false;
+	}
+	if (wlr_single_pixel_buffer_v1_try_from_buffer(buffer)) {
+		/* The scene turns these into rect fills with their own rounding. */
+		build->reject = "single-pixel buffer";
+		return false;
+	}
+
+	struct wlr_box box = {
+		.x = lx - build->scene_output->x,
+		.y = ly - build->scene_output->y,
+		.width = buffer->width,
+		.height = buffer->height,
+	};
+	struct wlr_box visible = box;
+	if (!clip_to_output(build, &visible)) {
+		return true;
+	}
+	struct soft_source *source = frame_source(build->frame, buffer);
+	if (!source) {
+		build->reject = "buffer without CPU access";
+		return false;
+	}
+	bool has_alpha;
+	if (source->format == DRM_FORMAT_ARGB8888) {
+		has_alpha = true;
+	} else if (source->format == DRM_FORMAT_XRGB8888) {
+		has_alpha = false;
+	} else {
+		build->reject = "unsupported buffer format";
+		return false;
+	}
+
+	if (!has_alpha) {
+		return frame_add_source_op(build->frame, SOFT_OP_COPY, &visible, source, &box,
+			0xff000000u, scene_buffer);
+	}
+
+	/*
+	 * Like the scene, draw what the client declared opaque without blending,
+	 * so stray alpha there is copied rather than mixed with what is below.
+	 */
+	pixman_region32_t opaque, blended;
+	pixman_region32_init(&opaque);
+	pixman_region32_copy(&opaque, &scene_buffer->opaque_region);
+	pixman_region32_translate(&opaque, box.x, box.y);
+	pixman_region32_intersect_rect(&opaque, &opaque, visible.x, visible.y,
+		(unsigned)visible.width, (unsigned)visible.height);
+	pixman_region32_init_rect(&blended, visible.x, visible.y,
+		(unsigned)visible.width, (unsigned)visible.height);
+	pixman_region32_subtract(&blended, &blended, &opaque);
+
+	bool ok = true;
+	const pixman_region32_t *regions[] = { &blended, &opaque };
+	const enum soft_op_type types[] = { SOFT_OP_BLEND, SOFT_OP_COPY };
+	for (size_t r = 0; r < 2 && ok; r++) {
+		int nrects = 0;
+		const pixman_box32_t *rects = pixman_region32_rectangles(
+			(pixman_region32_t *)regions[r], &nrects);
+		for (int i = 0; i < nrects && ok; i++) {
+			struct wlr_box part = {
+				.x = rects[i].x1,
+				.y = rects[i].y1,
+				.width = rects[i].x2 - rects[i].x1,
+				.height = rects[i].y2 - rects[i].y1,
+			};
+			ok = frame_add_source_op(build->frame, types[r], &part, source, &box, 0,
+				scene_buffer);
+			/* Sample the buffer once, not once per rectangle. */
+			scene_buffer = NULL;
+		}
+	}
+	pixman_region32_fini(&opaque);
+	pixman_region32_fini(&blended);
+	return ok;
+}
+
+static bool build_node(struct soft_build *build, struct wlr_scene_node *node, int lx, int ly) {
+	if (!node->enabled) {
+		return true;
+	}
+	switch (node->type) {
+	case WLR_SCENE_NODE_TREE: {
+		struct wlr_scene_tree *tree = wlr_scene_tree_from_node(node);
+		struct wlr_scene_node *child;
+		wl_list_for_each(child, &tree->children, link) {
+			if (!build_node(build, child, lx + child->x, ly + child->y)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	case WLR_SCENE_NODE_RECT:
+		return build_rect(build, wlr_scene_rect_from_node(node), lx, ly);
+	case WLR_SCENE_NODE_BUFFER:
+		return build_buffer(build, wlr_scene_buffer_from_node(node), lx, ly);
+	}
+	return true;
+}
+
+static bool output_has_software_cursor(struct wlr_output *wlr_output) {
+	struct wlr_output_cursor *cursor;
+	wl_list_for_each(cursor, &wlr_output->cursors, link) {
+		if (cursor->enabled && cursor->visible && cursor != wlr_output->hardware_cursor) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void render_area(const struct soft_frame *frame, const struct soft_kernels *kernels,
+		uint32_t *dst, const struct wlr_box *area) {
+	kernels->fill(dst + (size_t)area->y * frame->dst_stride + (size_t)area->x,
+		frame->dst_stride, area->width, area->height, SOFT_BACKGROUND, false);
+	for (size_t i = 0; i < frame->op_count; i++) {
+		const struct soft_op *op = &frame->ops[i];
+		struct wlr_box part;
+		if (!wlr_box_intersection(&part, &op->box, area)) {
+			continue;
+		}
+		uint32_t *out = dst + (size_t)part.y * frame->dst_stride + (size_t)part.x;
+		const uint32_t *in = op->src ? op->src +
+			(size_t)(part.y - op->box.y) * op->src_stride + (size_t)(part.x - op->box.x) : NULL;
+		switch (op->type) {
+		case SOFT_OP_FILL:
+			kernels->fill(out, frame->dst_stride, part.width, part.height,
+				op->color, op->blend);
+			break;
+		case SOFT_OP_COPY:
+			kernels->copy(out, frame->dst_stride, in, op->src_stride,
+				part.width, part.height, op->or_mask);
+			break;
+		case SOFT_OP_BLEND:
+			kernels->blend(out, frame->dst_stride, in, op->src_stride,
+				part.width, part.height);
+			break;
+		}
+	}
+}
+
+static void render_tile(const struct soft_frame *frame, const struct soft_kernels *kernels,
+		uint32_t *dst, const struct wlr_box *tile) {
+	pixman_region32_t clip;
+	pixman_region32_init_rect(&clip, tile->x, tile->y,
+		(unsigned)tile->width, (unsigned)tile->height);
+	pixman_region32_intersect(&clip, &clip, (pixman_region32_t *)frame->repaint);
+	int nrects = 0;
+	const pixman_box32_t *rects = pixman_region32_rectangles(&clip, &nrects);
+	for (int i = 0; i < nrects; i++) {
+		struct wlr_box area = {
+			.x = rects[i].x1,
+			.y = rects[i].y1,
+			.width = rects[i].x2 - rects[i].x1,
+			.height = rects[i].y2 - rects[i].y1,
+		};
+		render_area(frame, kernels, dst, &area);
+	}
+	pixman_region32_fini(&clip);
+}
+
+static void run_tiles(struct flux_soft_compositor *soft) {
+	const struct soft_frame *frame = &soft->frame;
+	for (;;) {
+		size_t i = atomic_fetch_add(&soft->next_tile, 1);
+		if (i >= frame->tile_count) {
+			return;
+		}
+		render_tile(frame, soft->kernels, frame->dst, &frame->tiles[i]);
+	}
+}
+
+static void *soft_worker(void *data) {
+	struct flux_soft_compositor *soft = data;
+	uint64_t seen = 0;
+	pthread_mutex_lock(&soft->lock);
+	for (;;) {
+		while (!soft->stopping && soft->generation == seen) {
+			pthread_cond_wait(&soft->work_cond, &soft->lock);
+		}
+		if (soft->stopping) {
+			break;
+		}
+		seen = soft->generation;
+		pthread_mutex_unlock(&soft->lock);
+
+		run_tiles(soft);
+
+		pthread_mutex_lock(&soft->lock);
+		if (--soft->workers_busy == 0) {
+			pthread_cond_signal(&soft->done_cond);
+		}
+	}
+	pthread_mutex_unlock(&soft->lock);
+	return NULL;
+}
+
+static bool build_tiles(struct soft_frame *frame) {
+	frame->tile_count = 0;
+	const pixman_box32_t *extents = pixman_region32_extents(
+		(pixman_region32_t *)frame->repaint);
+	int x0 = extents->x1 / SOFT_TILE_SIZE * SOFT_TILE_SIZE;
+	int y0 = extents->y1 / SOFT_TILE_SIZE * SOFT_TILE_SIZE;
+	for (int y = y0; y < extents->y2; y += SOFT_TILE_SIZE) {
+		for (int x = x0; x < extents->x2; x += SOFT_TILE_SIZE) {
+			pixman_box32_t cell = {
+				x, y, x + SOFT_TILE_SIZE, y + SOFT_TILE_SIZE,
+			};
+			if (pixman_region32_contains_rectangle((pixman_region32_t *)frame->repaint,
+					&cell) == PIXMAN_REGION_OUT) {
+				continue;
+			}
+			if (!grow((void **)&frame->tiles, &frame->tile_cap,
+					frame->tile_count + 1, sizeof(*frame->tiles))) {
+				return false;
+			}
+			frame->tiles[frame->tile_count++] = (struct wlr_box){
+				.x = x,
+				.y = y,
+				.width = SOFT_TILE_SIZE,
+				.height = SOFT_TILE_SIZE,
+			};
+		}
+	}
+	return true;
+}
+
+static void soft_run_frame(struct flux_soft_compositor *soft) {
+	atomic_store(&soft->next_tile, 0);
+	if (soft->thread_count > 0) {
+		pthread_mutex_lock(&soft->lock);
+		soft->generation++;
+		soft->workers_busy = soft->thread_count;
+		pthread_cond_broadcast(&soft->work_cond);
+		pthread_mutex_unlock(&soft->lock);
+	}
+
+	run_tiles(soft);
+
+	if (soft->thread_count > 0) {
+		pthread_mutex_lock(&soft->lock);
+		while (soft->workers_busy > 0) {
+			pthread_cond_wait(&soft->done_cond, &soft->lock);
+		}
+		pthread_mutex_unlock(&soft->lock);
+	}
+}
+
+/*
+ * Render the same frame through wlr_scene_output_build_state into a buffer
+ * from a private swapchain and compare the repaint region. This checks the
+ * scene flattening as well as the kernels against what the pixman renderer
+ * would have shown. The reference render shares the scene output's damage
+ * ring, which costs the real buffers at most an extra full repaint.
+ */
+static void soft_verify_frame(struct flux_output *output,
+		struct wlr_scene_output *scene_output, const struct soft_frame *frame,
+		bool x_channel) {
+	struct wlr_output *wlr_output = output->wlr_output;
+	struct wlr_swapchain *primary = wlr_output->swapchain;
+	struct wlr_swapchain *swapchain = output->soft_verify_swapchain;
+	if (swapchain && (swapchain->width != primary->width ||
+			swapchain->height != primary->height ||
+			swapchain->format.format != primary->format.format)) {
+		wlr_swapchain_destroy(swapchain);
+		swapchain = output->soft_verify_swapchain = NULL;
+	}
+	if (!swapchain) {
+		swapchain = wlr_swapchain_create(output->server->allocator,
+			primary->width, primary->height, &primary->format);
+		if (!swapchain) {
+			wlr_log(WLR_ERROR, "soft compositor: %s: no swapchain to verify against",
+				wlr_output->name);
+			return;
+		}
+		output->soft_verify_swapchain = swapchain;
+	}
+
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	struct wlr_scene_output_state_options options = { .swapchain = swapchain };
+	void *data = NULL;
+	uint32_t format = 0;
+	size_t stride = 0;
+	/* Direct scanout leaves no reference render for this frame. */
+	if (!wlr_scene_output_build_state(scene_output, &state, &options) ||
+			!(state.committed & WLR_OUTPUT_STATE_BUFFER) ||
+			!wlr_swapchain_has_buffer(swapchain, state.buffer) ||
+			!wlr_buffer_begin_data_ptr_access(state.buffer,
+				WLR_BUFFER_DATA_PTR_ACCESS_READ, &data, &format, &stride)) {
+		wlr_output_state_finish(&state);
+		return;
+	}
+
+	uint32_t mask = x_channel ? 0x00ffffffu : 0xffffffffu;
+	uint64_t mismatched = 0;
+	int first_x = -1, first_y = -1;
+	int nrects = 0;
+	const pixman_box32_t *rects = pixman_region32_rectangles(
+		(pixman_region32_t *)frame->repaint, &nrects);
+	for (int i = 0; i < nrects; i++) {
+		for (int y = rects[i].y1; y < rects[i].y2; y++) {
+			const uint32_t *got = frame->dst + (size_t)y * frame->dst_stride;
+			const uint32_t *want = (const uint32_t *)((const uint8_t *)data +
+				(size_t)y * stride);
+			for (int x = rects[i].x1; x < rects[i].x2; x++) {
+				if ((got[x] ^ want[x]) & mask) {
+					if (mismatched++ == 0) {
+						first_x = x;
+						first_y = y;
+					}
+				}
+			}
+		}
+	}
+	wlr_buffer_end_data_ptr_access(state.buffer);
+	wlr_output_state_finish(&state);
+	if (mismatched > 0) {
+		output->soft_verify_mismatches += mismatched;
+		wlr_log(WLR_ERROR, "soft compositor: %s: %llu pixel(s) differ from the scene render, first at %d,%d",
+			wlr_output->name, (unsigned long long)mismatched, first_x, first_y);
+	}
+}
+
+void soft_compositor_output_destroy(struct flux_output *output) {
+	if (output->soft_verify_swapchain) {
+		wlr_swapchain_destroy(output->soft_verify_swapchain);
+		output->soft_verify_swapchain = NULL;
+	}
+}
+
+bool soft_compositor_build_state(struct flux_output *output,
+		struct wlr_scene_output *scene_output, struct wlr_output_state *state) {
+	struct flux_soft_compositor *soft = output->server->soft_compositor;
+	struct wlr_output *wlr_output = output->wlr_output;
+	if (!soft) {
+		return false;
+	}
+	if (wlr_output->scale != 1.0f || wlr_output->transform != WL_OUTPUT_TRANSFORM_NORMAL ||
+			output_has_software_cursor(wlr_output)) {
+		output->soft_fallbacks++;
+		return false;
+	}
+	if (!wlr_output_configure_primary_swapchain(wlr_output, state, &wlr_output->swapchain)) {
+		return false;
+	}
+
+	struct soft_frame *frame = &soft->frame;
+	frame->op_count = 0;
+	frame->width = wlr_output->width;
+	frame->height = wlr_output->height;
+	struct soft_build build = {
+		.frame = frame,
+		.scene_output = scene_output,
+	};
+	struct wlr_scene_node *root = &output->server->scene->tree.node;
+	if (!build_node(&build, root, root->x, root->y)) {
+		frame_release_sources(frame);
+		output->soft_fallbacks++;
+		wlr_log(WLR_DEBUG, "soft compositor: %s: scene path for this frame (%s)",
+			wlr_output->name, build.reject ? build.reject : "out of memory");
+		return false;
+	}
+
+	struct wlr_buffer *buffer = wlr_swapchain_acquire(wlr_output->swapchain);
+	if (!buffer) {
+		frame_release_sources(frame);
+		return false;
+	}
+	void *data = NULL;
+	uint32_t format = 0;
+	size_t stride = 0;
+	if (!wlr_buffer_begin_data_ptr_access(buffer,
+			WLR_BUFFER_DATA_PTR_ACCESS_READ | WLR_BUFFER_DATA_PTR_ACCESS_WRITE,
+			&data, &format, &stride)) {
+		wlr_buffer_unlock(buffer);
+		frame_release_sources(frame);
+		output->soft_fallbacks++;
+		return false;
+	}
+	if ((format != DRM_FORMAT_XRGB8888 && format != DRM_FORMAT_ARGB8888) || stride % 4 != 0) {
+		wlr_buffer_end_data_ptr_access(buffer);
+		wlr_buffer_unlock(buffer);
+		frame_release_sources(frame);
+		output->soft_fallbacks++;
+		return false;
+	}
+
+	/* Committed to this path: from here the damage ring knows the buffer. */
+	pixman_region32_t repaint;
+	pixman_region32_init(&repaint);
+	wlr_damage_ring_rotate_buffer(&scene_output->damage_ring, buffer, &repaint);
+	pixman_region32_intersect_rect(&repaint, &repaint, 0, 0,
+		(unsigned)frame->width, (unsigned)frame->height);
+
+	frame->dst = data;
+	frame->dst_stride = stride / 4;
+	frame->repaint = &repaint;
+	bool ok = build_tiles(frame);
+	if (ok) {
+		soft_run_frame(soft);
+	} else {
+		/* Keep the buffer consistent with the ring even if tiling failed. */
+		struct wlr_box whole = { .width = frame->width, .height = frame->height };
+		render_tile(frame, soft->kernels, frame->dst, &whole);
+	}
+	/* The scene render below takes its own data-ptr access to the same buffers. */
+	frame_release_sources(frame);
+	if (ok && soft->verify) {
+		soft_verify_frame(output, scene_output, frame, format == DRM_FORMAT_XRGB8888);
+	}
+	frame->repaint = NULL;
+	pixman_region32_fini(&repaint);
+	wlr_buffer_end_data_ptr_access(buffer);
+
+	struct wlr_scene_output_sample_event event = {
+		.output = scene_output,
+		.direct_scanout = false,
+	};
+	for (size_t i = 0; i < frame->op_count; i++) {
+		if (frame->ops[i].scene_buffer) {
+			wl_signal_emit_mutable(&frame->ops[i].scene_buffer->events.output_sample, &event);
+		}
+	}
+
+	wlr_output_state_set_buffer(state, buffer);
+	wlr_buffer_unlock(buffer);
+	wlr_output_state_set_damage(state, &scene_output->pending_commit_damage);
+	output->frames_soft++;
+	return true;
+}
+
+bool soft_compositor_init(struct flux_server *server) {
+	if (env_int("FLUX_SOFT_COMPOSITOR", 0) == 0) {
+		return true;
+	}
+	if (!wlr_renderer_is_pixman(server->renderer)) {
+		wlr_log(WLR_INFO, "soft compositor: renderer is not pixman; leaving it off");
+		return true;
+	}
+
+	struct flux_soft_compositor *soft = calloc(1, sizeof(*soft));
+	if (!soft) {
+		return false;
+	}
+	soft->server = server;
+	soft->kernels = soft_kernels_best();
+	soft->verify = env_int("FLUX_SOFT_COMPOSITOR_VERIFY", 0) != 0;
+	pthread_mutex_init(&soft->lock, NULL);
+	pthread_cond_init(&soft->work_cond, NULL);
+	pthread_cond_init(&soft->done_cond, NULL);
+	atomic_init(&soft->next_tile, 0);
+
+	/* The main thread takes tiles too, so it counts as one of the threads. */
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int threads = env_int("FLUX_SOFT_COMPOSITOR_THREADS", cpus > 0 ? (int)cpus : 1);
+	if (threads < 1) {
+		threads = 1;
+	}
+	if (threads > SOFT_MAX_THREADS) {
+		threads = SOFT_MAX_THREADS;
+	}
+	for (int i = 0; i < threads - 1; i++) {
+		if (pthread_create(&soft->threads[i], NULL, soft_worker, soft) != 0) {
+			wlr_log(WLR_ERROR, "soft compositor: only %d of %d threads started",
+				soft->thread_count + 1, threads);
+			break;
+		}
+		soft->thread_count++;
+	}
+
+	server->soft_compositor = soft;
+	wlr_log(WLR_INFO, "soft compositor: %s kernels, %d thread(s)%s",
+		soft->kernels->name, soft->thread_count + 1,
+		soft->verify ? ", verifying against pixman" : "");
+	return true;
+}
+
+void soft_compositor_finish(struct flux_server *server) {
+	struct flux_soft_compositor *soft = server->soft_compositor;
+	if (!soft) {
+		return;
+	}
+	pthread_mutex_lock(&soft->lock);
+	soft->stopping = true;
+	pthread_cond_broadcast(&soft->work_cond);
+	pthread_mutex_unlock(&soft->lock);
+	for (int i = 0; i < soft->thread_count; i++) {
+		pthread_join(soft->threads[i], NULL);
+	}
+	pthread_mutex_destroy(&soft->lock);
+	pthread_cond_destroy(&soft->work_cond);
+	pthread_cond_destroy(&soft->done_cond);
+	free(soft->frame.ops);
+	free(soft->frame.sources);
+	free(soft->frame.tiles);
+	free(soft);
+	server->soft_compositor = NULL;
+}
@@ -0,0 +1,221 @@
+#include "flux.h"
+
+#include <pixman.h>
+
+/*
+ * Fill and blend kernels for the tiled software compositor. All pixels are
+ * premultiplied ARGB8888 and strides are in pixels. The arithmetic is pixman's
+ * own (MUL_UN8 rounding, saturating add) so results are bit-identical to the
+ * pixman renderer; the pixman table is the fallback for other compilers.
+ */
+
+static pixman_image_t *wrap_bits(pixman_format_code_t format, uint32_t *data,
+		size_t stride, int width, int height) {
+	return pixman_image_create_bits(format, width, height, data, (int)(stride * 4));
+}
+
+static void pixman_fill(uint32_t *dst, size_t stride, int width, int height,
+		uint32_t color, bool blend) {
+	pixman_image_t *dst_image = wrap_bits(PIXMAN_a8r8g8b8, dst, stride, width, height);
+	/* 8 -> 16 bit by replication, which pixman narrows back exactly. */
+	pixman_color_t pixman_color = {
+		.red = (uint16_t)(((color >> 16) & 0xff) * 0x101),
+		.green = (uint16_t)(((color >> 8) & 0xff) * 0x101),
+		.blue = (uint16_t)((color & 0xff) * 0x101),
+		.alpha = (uint16_t)((color >> 24) * 0x101),
+	};
+	pixman_image_t *fill = pixman_image_create_solid_fill(&pixman_color);
+	pixman_image_composite32(blend ? PIXMAN_OP_OVER : PIXMAN_OP_SRC, fill, NULL, dst_image,
+		0, 0, 0, 0, 0, 0, width, height);
+	pixman_image_unref(fill);
+	pixman_image_unref(dst_image);
+}
+
+static void pixman_copy(uint32_t *dst, size_t dst_stride, const uint32_t *src,
+		size_t src_stride, int width, int height, uint32_t or_mask) {
+	pixman_image_t *dst_image = wrap_bits(PIXMAN_a8r8g8b8, dst, dst_stride, width, height);
+	pixman_image_t *src_image = wrap_bits(or_mask ? PIXMAN_x8r8g8b8 : PIXMAN_a8r8g8b8,
+		(uint32_t *)src, src_stride, width, height);
+	pixman_image_composite32(PIXMAN_OP_SRC, src_image, NULL, dst_image,
+		0, 0, 0, 0, 0, 0, width, height);
+	pixman_image_unref(src_image);
+	pixman_image_unref(dst_image);
+}
+
+static void pixman_blend(uint32_t *dst, size_t dst_stride, const uint32_t *src,
+		size_t src_stride, int width, int height) {
+	pixman_image_t *dst_image = wrap_bits(PIXMAN_a8r8g8b8, dst, dst_stride, width, height);
+	pixman_image_t *src_image = wrap_bits(PIXMAN_a8r8g8b8,
+		(uint32_t *)src, src_stride, width, height);
+	pixman_image_composite32(PIXMAN_OP_OVER, src_image, NULL, dst_image,
+		0, 0, 0, 0, 0, 0, width, height);
+	pixman_image_unref(src_image);
+	pixman_image_unref(dst_image);
+}
+
+static const struct soft_kernels pixman_kernels = {
+	.name = "pixman",
+	.fill = pixman_fill,
+	.copy = pixman_copy,
+	.blend = pixman_blend,
+};
+
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+
+/*
+ * Written with GCC/Clang vector extensions rather than intrinsics so the same
+ * code becomes SSE2 on x86-64 and NEON on arm64, which is what Parallels runs
+ * on Apple silicon hosts.
+ */
+#if defined(__SSE2__)
+#define SIMD_KERNELS_NAME "simd (sse2)"
+#elif defined(__ARM_NEON)
+#define SIMD_KERNELS_NAME "simd (neon)"
+#else
+#define SIMD_KERNELS_NAME "simd (generic)"
+#endif
+
+typedef uint8_t u8x16 __attribute__((vector_size(16)));
+typedef uint16_t u16x16 __attribute__((vector_size(32)));
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+
+static inline u32x4 load_4(const uint32_t *p) {
+	u32x4 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline void store_4(uint32_t *p, u32x4 v) {
+	memcpy(p, &v, sizeof(v));
+}
+
+static inline bool all_lanes(i32x4 mask) {
+	uint64_t words[2];
+	memcpy(words, &mask, sizeof(words));
+	return (words[0] & words[1]) == UINT64_MAX;
+}
+
+static inline uint32_t mul_un8(uint32_t a, uint32_t b) {
+	uint32_t t = a * b + 0x80;
+	return ((t >> 8) + t) >> 8;
+}
+
+static inline uint32_t over_pixel(uint32_t src, uint32_t dst) {
+	uint32_t inv_alpha = 255 - (src >> 24);
+	uint32_t out = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		uint32_t c = ((src >> shift) & 0xff) + mul_un8((dst >> shift) & 0xff, inv_alpha);
+		out |= (c > 255 ? 255 : c) << shift;
+	}
+	return out;
+}
+
+/* Four pixels of OVER: MUL_UN8 in 16-bit lanes, then a saturating add. */
+static inline u32x4 over_4(u32x4 src, u32x4 dst) {
+	u32x4 alpha = src >> 24;
+	alpha |= alpha << 8;
+	alpha |= alpha << 16;
+	u16x16 inv_alpha = __builtin_convertvector((u8x16)~alpha, u16x16);
+	u16x16 t = __builtin_convertvector((u8x16)dst, u16x16) * inv_alpha + 0x80;
+	u16x16 sum = __builtin_convertvector((u8x16)src, u16x16) + (((t >> 8) + t) >> 8);
+	u16x16 over = (u16x16)(sum > 0xff);
+	sum = (sum & ~over) | (over & 0xff);
+	return (u32x4)__builtin_convertvector(sum, u8x16);
+}
+
+static void simd_fill(uint32_t *dst, size_t stride, int width, int height,
+		uint32_t color, bool blend) {
+	if (blend && (color >> 24) == 0xff) {
+		blend = false;
+	}
+	if (blend && color == 0) {
+		return;
+	}
+	u32x4 color4 = {color, color, color, color};
+	for (int y = 0; y < height; y++) {
+		uint32_t *row = dst + (size_t)y * stride;
+		int x = 0;
+		if (blend) {
+			for (; x + 4 <= width; x += 4) {
+				store_4(row + x, over_4(color4, load_4(row + x)));
+			}
+			for (; x < width; x++) {
+				row[x] = over_pixel(color, row[x]);
+			}
+		} else {
+			for (; x + 4 <= width; x += 4) {
+				store_4(row + x, color4);
+			}
+			for (; x < width; x++) {
+				row[x] = color;
+			}
+		}
+	}
+}
+
+static void simd_copy(uint32_t *dst, size_t dst_stride, const uint32_t *src,
+		size_t src_stride, int width, int height, uint32_t or_mask) {
+	u32x4 mask4 = {or_mask, or_mask, or_mask, or_mask};
+	for (int y = 0; y < height; y++) {
+		uint32_t *out = dst + (size_t)y * dst_stride;
+		const uint32_t *in = src + (size_t)y * src_stride;
+		if (or_mask == 0) {
+			memcpy(out, in, (size_t)width * 4);
+			continue;
+		}
+		int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			store_4(out + x, load_4(in + x) | mask4);
+		}
+		for (; x < width; x++) {
+			out[x] = in[x] | or_mask;
+		}
+	}
+}
+
+static void simd_blend(uint32_t *dst, size_t dst_stride, const uint32_t *src,
+		size_t src_stride, int width, int height) {
+	const u32x4 alpha_mask = {0xff000000u, 0xff000000u, 0xff000000u, 0xff000000u};
+	for (int y = 0; y < height; y++) {
+		uint32_t *out = dst + (size_t)y * dst_stride;
+		const uint32_t *in = src + (size_t)y * src_stride;
+		int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			u32x4 s = load_4(in + x);
+			/* Runs of opaque or fully clear pixels are the common case. */
+			if (all_lanes((s & alpha_mask) == alpha_mask)) {
+				store_4(out + x, s);
+				continue;
+			}
+			if (all_lanes(s == 0)) {
+				continue;
+			}
+			store_4(out + x, over_4(s, load_4(out + x)));
+		}
+		for (; x < width; x++) {
+			out[x] = over_pixel(in[x], out[x]);
+		}
+	}
+}
+
+static const struct soft_kernels simd_kernels = {
+	.name = SIMD_KERNELS_NAME,
+	.fill = simd_fill,
+	.copy = simd_copy,
+	.blend = simd_blend,
+};
+
+#endif
+
+const struct soft_kernels *soft_kernels_pixman(void) {
+	return &pixman_kernels;
+}
+
+const struct soft_kernels *soft_kernels_best(void) {
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 9)
+	return &simd_kernels;
+#else
+	return &pixman_kernels;
+#endif
+}
@@ -0,0 +1,970 @@
+#define _XOPEN_SOURCE 700 /* realpath */
+
+#include "flux.h"
+
+#include <dirent.h>
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <png.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <wlr/interfaces/wlr_buffer.h>
+
+/*
+ * Image wallpaper. The PNG is decoded and scaled to each distinct output pixel
+ * size on a worker thread. Every scaled image is written to a cache file under
+ * ~/.cache/flux and memory-mapped, so later starts and hotplugs map the file
+ * instead of decoding again. Outputs with the same pixel size share one buffer,
+ * and a size is dropped once no output uses it.
+ */
+
+#define WALLPAPER_CACHE_MAGIC 0x31505746u /* "FWP1" */
+#define WALLPAPER_CACHE_DATA_OFFSET 64
+#define WALLPAPER_MAX_DIMENSION 16384
+/* Scaled sizes of the current image kept on disk, for hotplug and docking. */
+#define WALLPAPER_CACHE_SIZES_KEPT 4
+
+enum wallpaper_fit {
+	WALLPAPER_FILL,
+	WALLPAPER_FIT,
+	WALLPAPER_STRETCH,
+};
+
+struct wallpaper_cache_header {
+	uint32_t magic;
+	uint32_t fit;
+	int32_t width;
+	int32_t height;
+	uint32_t stride;
+	uint32_t background;
+	uint64_t source_size;
+	int64_t source_mtime_sec;
+	int64_t source_mtime_nsec;
+};
+
+_Static_assert(sizeof(struct wallpaper_cache_header) <= WALLPAPER_CACHE_DATA_OFFSET,
+	"wallpaper cache header overlaps pixel data");
+
+struct wallpaper_pixels {
+	void *map;
+	size_t map_len;
+	bool mapped;
+	uint32_t *data;
+	size_t stride;
+};
+
+struct flux_wallpaper_buffer {
+	struct wlr_buffer base;
+	struct wallpaper_pixels pixels;
+};
+
+struct wallpaper_image {
+	struct wl_list link; // flux_wallpaper::images
+	int width;
+	int height;
+	struct flux_wallpaper_buffer *buffer; // NULL until scaled
+	bool failed;
+	bool queued; // a job still points at it
+	int users; // outputs showing it
+};
+
+struct wallpaper_job {
+	struct wallpaper_job *next;
+	struct wallpaper_image *image;
+	int width;
+	int height;
+	struct wallpaper_pixels pixels;
+	bool ok;
+	uint64_t scale_nsec;
+};
+
+struct flux_wallpaper {
+	struct flux_server *server;
+	char path[PATH_MAX];
+	struct stat source;
+	enum wallpaper_fit fit;
+	uint32_t background;
+	uint64_t key;
+	struct wl_list images; // wallpaper_image::link
+
+	pthread_t thread;
+	bool thread_started;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct wallpaper_job *pending;
+	struct wallpaper_job *done;
+	bool stopping;
+	int notify_fds[2];
+	struct wl_event_source *notify_source;
+
+	/* Owned by the worker; kept so a hotplug at a new size only rescales. */
+	uint32_t *decoded;
+	int decoded_width;
+	int decoded_height;
+	bool decode_failed;
+};
+
+static const char *fit_name(enum wallpaper_fit fit) {
+	switch (fit) {
+	case WALLPAPER_FIT:
+		return "fit";
+	case WALLPAPER_STRETCH:
+		return "stretch";
+	case WALLPAPER_FILL:
+	default:
+		return "fill";
+	}
+}
+
+static void wallpaper_pixels_release(struct wallpaper_pixels *pixels) {
+	if (pixels->mapped) {
+		munmap(pixels->map, pixels->map_len);
+	} else {
+		free(pixels->map);
+	}
+	memset(pixels, 0, sizeof(*pixels));
+}
+
+static struct flux_wallpaper_buffer *wallpaper_buffer_from_base(struct wlr_buffer *buffer) {
+	struct flux_wallpaper_buffer *wallpaper_buffer =
+		wl_container_of(buffer, wallpaper_buffer, base);
+	return wallpaper_buffer;
+}
+
+static void wallpaper_buffer_destroy(struct wlr_buffer *buffer) {
+	struct flux_wallpaper_buffer *wallpaper_buffer = wallpaper_buffer_from_base(buffer);
+	wallpaper_pixels_release(&wallpaper_buffer->pixels);
+	free(wallpaper_buffer);
+}
+
+static bool wallpaper_buffer_begin_data_ptr_access(struct wlr_buffer *buffer,
+		uint32_t flags, void **data, uint32_t *format, size_t *stride) {
+	/* Cache mappings are shared with the page cache and never written. */
+	if (flags & WLR_BUFFER_DATA_PTR_ACCESS_WRITE) {
+		return false;
+	}
+	struct flux_wallpaper_buffer *wallpaper_buffer = wallpaper_buffer_from_base(buffer);
+	*data = wallpaper_buffer->pixels.data;
+	*format = DRM_FORMAT_XRGB8888;
+	*stride = wallpaper_buffer->pixels.stride;
+	return true;
+}
+
+static void wallpaper_buffer_end_data_ptr_access(struct wlr_buffer *buffer) {
+	(void)buffer;
+}
+
+static const struct wlr_buffer_impl wallpaper_buffer_impl = {
+	.destroy = wallpaper_buffer_destroy,
+	.begin_data_ptr_access = wallpaper_buffer_begin_data_ptr_access,
+	.end_data_ptr_access = wallpaper_buffer_end_data_ptr_access,
+};
+
+static struct flux_wallpaper_buffer *wallpaper_buffer_create(int width, int height,
+		struct wallpaper_pixels *pixels) {
+	struct flux_wallpaper_buffer *buffer = calloc(1, sizeof(*buffer));
+	if (!buffer) {
+		return NULL;
+	}
+	wlr_buffer_init(&buffer->base, &wallpaper_buffer_impl, width, height);
+	buffer->pixels = *pixels;
+	memset(pixels, 0, sizeof(*pixels));
+	return buffer;
+}
+
+static uint32_t color_to_xrgb(const float color[4]) {
+	uint32_t r = (uint32_t)lroundf(color[0] * 255.0f);
+	uint32_t g = (uint32_t)lroundf(color[1] * 255.0f);
+	uint32_t b = (uint32_t)lroundf(color[2] * 255.0f);
+	return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+static bool wallpaper_cache_path(const struct flux_wallpaper *wallpaper,
+		int width, int height, char out[PATH_MAX]) {
+	const char *cache_home = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	int n;
+	if (cache_home && cache_home[0] != '\0') {
+		n = snprintf(out, PATH_MAX, "%s/flux/wallpaper-%016llx-%dx%d.bin", cache_home,
+			(unsigned long long)wallpaper->key, width, height);
+	} else if (home && home[0] != '\0') {
+		n = snprintf(out, PATH_MAX, "%s/.cache/flux/wallpaper-%016llx-%dx%d.bin", home,
+			(unsigned long long)wallpaper->key, width, height);
+	} else {
+		return false;
+	}
+	return n > 0 && n < PATH_MAX;
+}
+
+struct wallpaper_cache_entry {
+	char name[NAME_MAX + 1];
+	struct timespec mtime;
+};
+
+/* Newest first. */
+static int compare_cache_entries(const void *a, const void *b) {
+	const struct timespec *lhs = &((const struct wallpaper_cache_entry *)a)->mtime;
+	const struct timespec *rhs = &((const struct wallpaper_cache_entry *)b)->mtime;
+	if (lhs->tv_sec != rhs->tv_sec) {
+		return (rhs->tv_sec > lhs->tv_sec) - (rhs->tv_sec < lhs->tv_sec);
+	}
+	return (rhs->tv_nsec > lhs->tv_nsec) - (rhs->tv_nsec < lhs->tv_nsec);
+}
+
+/*
+ * Runs after a new cache file is renamed into place. Files for any other
+ * image are deleted, and of this image's sizes only the most recently
+ * written are kept. Mappings of deleted files stay valid until unmapped.
+ */
+static void wallpaper_cache_prune(const struct flux_wallpaper *wallpaper,
+		const char *final_path) {
+	char dir_path[PATH_MAX];
+	snprintf(dir_path, sizeof(dir_path), "%s", final_path);
+	char *slash = strrchr(dir_path, '/');
+	if (!slash) {
+		return;
+	}
+	*slash = '\0';
+	DIR *dir = opendir(dir_path);
+	if (!dir) {
+		return;
+	}
+
+	struct wallpaper_cache_entry *entries = NULL;
+	size_t count = 0, capacity = 0;
+	int removed = 0;
+	struct dirent *dirent;
+	while ((dirent = readdir(dir))) {
+		unsigned long long key;
+		int width, height, end = 0;
+		if (sscanf(dirent->d_name, "wallpaper-%16llx-%dx%d.bin%n",
+				&key, &width, &height, &end) != 3 || dirent->d_name[end] != '\0') {
+			continue;
+		}
+		if (key != wallpaper->key) {
+			removed += unlinkat(dirfd(dir), dirent->d_name, 0) == 0;
+			continue;
+		}
+		struct stat st;
+		if (fstatat(dirfd(dir), dirent->d_name, &st, 0) != 0) {
+			continue;
+		}
+		if (count == capacity) {
+			size_t grown = capacity ? capacity * 2 : 8;
+			struct wallpaper_cache_entry *resized = realloc(entries, grown * sizeof(*entries));
+			if (!resized) {
+				break;
+			}
+			entries = resized;
+			capacity = grown;
+		}
+		snprintf(entries[count].name, sizeof(entries[count].name), "%s", dirent->d_name);
+		entries[count].mtime = st.st_mtim;
+		count++;
+	}
+
+	qsort(entries, count, sizeof(*entries), compare_cache_entries);
+	for (size_t i = WALLPAPER_CACHE_SIZES_KEPT; i < count; i++) {
+		removed += unlinkat(dirfd(dir), entries[i].name, 0) == 0;
+	}
+	free(entries);
+	closedir(dir);
+	if (removed > 0) {
+		wlr_log(WLR_INFO, "wallpaper: removed %d stale cache file%s from %s",
+			removed, removed == 1 ? "" : "s", dir_path);
+	}
+}
+
+static void wallpaper_fill_header(const struct flux_wallpaper *wallpaper,
+		int width, int height, size_t stride, struct wallpaper_cache_header *header) {
+	memset(header, 0, sizeof(*header));
+	header->magic = WALLPAPER_CACHE_MAGIC;
+	header->fit = (uint32_t)wallpaper->fit;
+	header->width = width;
+	header->height = height;
+	header->stride = (uint32_t)stride;
+	header->background = wallpaper->background;
+	header->source_size = (uint64_t)wallpaper->source.st_size;
+	header->source_mtime_sec = (int64_t)wallpaper->source.st_mtim.tv_sec;
+	header->source_mtime_nsec = (int64_t)wallpaper->source.st_mtim.tv_nsec;
+}
+
+/* Map a previously scaled image if the cache entry matches the current source. */
+static bool wallpaper_cache_map(const struct flux_wallpaper *wallpaper,
+		int width, int height, struct wallpaper_pixels *out) {
+	char path[PATH_MAX];
+	if (!wallpaper_cache_path(wallpaper, width, height, path)) {
+		return false;
+	}
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0) {
+		return false;
+	}
+
+	size_t stride = (size_t)width * 4;
+	size_t len = WALLPAPER_CACHE_DATA_OFFSET + stride * (size_t)height;
+	struct stat st;
+	void *map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size == len) {
+		map = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		return false;
+	}
+
+	struct wallpaper_cache_header expected;
+	wallpaper_fill_header(wallpaper, width, height, stride, &expected);
+	if (memcmp(map, &expected, sizeof(expected)) != 0) {
+		munmap(map, len);
+		return false;
+	}
+
+	out->map = map;
+	out->map_len = len;
+	out->mapped = true;
+	out->data = (uint32_t *)((uint8_t *)map + WALLPAPER_CACHE_DATA_OFFSET);
+	out->stride = stride;
+	return true;
+}
+
+/*
+ * Create the cache file and map it writable so the scaler writes straight into
+ * it. It is only renamed into place once complete. Falls back to plain memory
+ * when there is no usable cache directory.
+ */
+static bool wallpaper_pixels_alloc(const struct flux_wallpaper *wallpaper,
+		int width, int height, struct wallpaper_pixels *out,
+		char final_path[PATH_MAX], char tmp_path[PATH_MAX]) {
+	size_t stride = (size_t)width * 4;
+	size_t len = WALLPAPER_CACHE_DATA_OFFSET + stride * (size_t)height;
+	final_path[0] = '\0';
+
+	if (wallpaper_cache_path(wallpaper, width, height, final_path)) {
+		int n = snprintf(tmp_path, PATH_MAX, "%s.%d.tmp", final_path, (int)getpid());
+		if (n > 0 && n < PATH_MAX) {
+			create_parent_dirs(final_path);
+			int fd = open(tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+			if (fd >= 0) {
+				void *map = MAP_FAILED;
+				if (ftruncate(fd, (off_t)len) == 0) {
+					map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				}
+				close(fd);
+				if (map != MAP_FAILED) {
+					out->map = map;
+					out->mapped = true;
+				} else {
+					unlink(tmp_path);
+				}
+			}
+		}
+	}
+	if (!out->mapped) {
+		final_path[0] = '\0';
+		out->map = malloc(len);
+		if (!out->map) {
+			return false;
+		}
+	}
+
+	out->map_len = len;
+	out->data = (uint32_t *)((uint8_t *)out->map + WALLPAPER_CACHE_DATA_OFFSET);
+	out->stride = stride;
+	return true;
+}
+
+/* Decode to opaque XRGB, compositing any transparency over the background color. */
+static bool wallpaper_decode(struct flux_wallpaper *wallpaper) {
+	FILE *fp = fopen(wallpaper->path, "rb");
+	if (!fp) {
+		wlr_log(WLR_ERROR, "wallpaper: cannot open %s: %s", wallpaper->path, strerror(errno));
+		return false;
+	}
+
+	png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	png_infop info = png ? png_create_info_struct(png) : NULL;
+	if (!info) {
+		png_destroy_read_struct(&png, NULL, NULL);
+		fclose(fp);
+		return false;
+	}
+
+	uint8_t *volatile rgba = NULL;
+	png_bytep *volatile rows = NULL;
+	uint32_t *volatile out = NULL;
+	if (setjmp(png_jmpbuf(png))) {
+		wlr_log(WLR_ERROR, "wallpaper: failed to decode %s", wallpaper->path);
+		free(rgba);
+		free(rows);
+		free(out);
+		png_destroy_read_struct(&png, &info, NULL);
+		fclose(fp);
+		return false;
+	}
+
+	png_init_io(png, fp);
+	png_read_info(png, info);
+	png_uint_32 width = 0, height = 0;
+	int bit_depth = 0, color_type = 0;
+	png_get_IHDR(png, info, &width, &height, &bit_depth, &color_type, NULL, NULL, NULL);
+	if (width == 0 || height == 0 ||
+			width > WALLPAPER_MAX_DIMENSION || height > WALLPAPER_MAX_DIMENSION) {
+		png_error(png, "unsupported image size");
+	}
+	if (bit_depth == 16) {
+		png_set_strip_16(png);
+	}
+	if (color_type == PNG_COLOR_TYPE_PALETTE) {
+		png_set_palette_to_rgb(png);
+	}
+	if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) {
+		png_set_expand_gray_1_2_4_to_8(png);
+	}
+	if (png_get_valid(png, info, PNG_INFO_tRNS)) {
+		png_set_tRNS_to_alpha(png);
+	}
+	if (color_type == PNG_COLOR_TYPE_RGB || color_type == PNG_COLOR_TYPE_GRAY ||
+			color_type == PNG_COLOR_TYPE_PALETTE) {
+		png_set_filler(png, 0xFF, PNG_FILLER_AFTER);
+	}
+	if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+		png_set_gray_to_rgb(png);
+	}
+	png_read_update_info(png, info);
+
+	size_t row_bytes = png_get_rowbytes(png, info);
+	rgba = malloc(row_bytes * height);
+	rows = calloc(height, sizeof(*rows));
+	out = malloc((size_t)width * height * sizeof(uint32_t));
+	if (!rgba || !rows || !out) {
+		png_error(png, "out of memory");
+	}
+	for (png_uint_32 y = 0; y < height; y++) {
+		rows[y] = rgba + (size_t)y * row_bytes;
+	}
+	png_read_image(png, rows);
+
+	uint32_t bg = wallpaper->background;
+	uint32_t bg_r = (bg >> 16) & 0xFF, bg_g = (bg >> 8) & 0xFF, bg_b = bg & 0xFF;
+	for (png_uint_32 y = 0; y < height; y++) {
+		const uint8_t *src = rows[y];
+		uint32_t *dst = out + (size_t)y * width;
+		for (png_uint_32 x = 0; x < width; x++, src += 4) {
+			uint32_t a = src[3];
+			uint32_t r = (src[0] * a + bg_r * (255 - a) + 127) / 255;
+			uint32_t g = (src[1] * a + bg_g * (255 - a) + 127) / 255;
+			uint32_t b = (src[2] * a + bg_b * (255 - a) + 127) / 255;
+			dst[x] = 0xFF000000u | (r << 16) | (g << 8) | b;
+		}
+	}
+
+	free(rgba);
+	free(rows);
+	png_destroy_read_struct(&png, &info, NULL);
+	fclose(fp);
+	wallpaper->decoded = out;
+	wallpaper->decoded_width = (int)width;
+	wallpaper->decoded_height = (int)height;
+	return true;
+}
+
+static uint32_t lerp_channel(uint32_t a, uint32_t b, uint32_t shift, uint32_t weight) {
+	uint32_t ca = (a >> shift) & 0xFF;
+	uint32_t cb = (b >> shift) & 0xFF;
+	return ((ca * (256 - weight) + cb * weight) >> 8) << shift;
+}
+
+static uint32_t lerp_pixel(uint32_t a, uint32_t b, uint32_t weight) {
+	return 0xFF000000u | lerp_channel(a, b, 16, weight) |
+		lerp_channel(a, b, 8, weight) | lerp_channel(a, b, 0, weight);
+}
+
+/*
+ * Scale the source rectangle onto the destination rectangle. Shrinking
+ * averages every source pixel under each destination pixel so fine detail
+ * does not alias. Enlarging interpolates bilinearly.
+ */
+static void wallpaper_scale(const uint32_t *src, int src_stride_px,
+		int sx, int sy, int sw, int sh, uint32_t *dst, size_t dst_stride_px,
+		int dx, int dy, int dw, int dh) {
+	if (sw >= dw && sh >= dh) {
+		for (int y = 0; y < dh; y++) {
+			int y0 = sy + (int)((int64_t)y * sh / dh);
+			int y1 = sy + (int)((int64_t)(y + 1) * sh / dh);
+			if (y1 <= y0) {
+				y1 = y0 + 1;
+			}
+			uint32_t *row = dst + (size_t)(dy + y) * dst_stride_px + dx;
+			for (int x = 0; x < dw; x++) {
+				int x0 = sx + (int)((int64_t)x * sw / dw);
+				int x1 = sx + (int)((int64_t)(x + 1) * sw / dw);
+				if (x1 <= x0) {
+					x1 = x0 + 1;
+				}
+				uint64_t r = 0, g = 0, b = 0;
+				for (int yy = y0; yy < y1; yy++) {
+					const uint32_t *s = src + (size_t)yy * src_stride_px;
+					for (int xx = x0; xx < x1; xx++) {
+						r += (s[xx] >> 16) & 0xFF;
+						g += (s[xx] >> 8) & 0xFF;
+						b += s[xx] & 0xFF;
+					}
+				}
+				uint64_t n = (uint64_t)(x1 - x0) * (uint64_t)(y1 - y0);
+				row[x] = 0xFF000000u | (uint32_t)((r / n) << 16) |
+					(uint32_t)((g / n) << 8) | (uint32_t)(b / n);
+			}
+		}
+		return;
+	}
+
+	for (int y = 0; y < dh; y++) {
+		/* Sample at pixel centres in 24.8 fixed point. */
+		int64_t fy = ((int64_t)(2 * y + 1) * sh * 256) / (2 * dh) - 128;
+		if (fy < 0) {
+			fy = 0;
+		}
+		int y0 = (int)(fy >> 8);
+		int y1 = y0 + 1 < sh ? y0 + 1 : sh - 1;
+		uint32_t wy = (uint32_t)(fy & 0xFF);
+		const uint32_t *r0 = src + (size_t)(sy + y0) * src_stride_px + sx;
+		const uint32_t *r1 = src + (size_t)(sy + y1) * src_stride_px + sx;
+		uint32_t *row = dst + (size_t)(dy + y) * dst_stride_px + dx;
+		for (int x = 0; x < dw; x++) {
+			int64_t fx = ((int64_t)(2 * x + 1) * sw * 256) / (2 * dw) - 128;
+			if (fx < 0) {
+				fx = 0;
+			}
+			int x0 = (int)(fx >> 8);
+			int x1 = x0 + 1 < sw ? x0 + 1 : sw - 1;
+			uint32_t wx = (uint32_t)(fx & 0xFF);
+			uint32_t top = lerp_pixel(r0[x0], r0[x1], wx);
+			uint32_t bottom = lerp_pixel(r1[x0], r1[x1], wx);
+			row[x] = lerp_pixel(top, bottom, wy);
+		}
+	}
+}
+
+static void wallpaper_render(const struct flux_wallpaper *wallpaper,
+		struct wallpaper_pixels *pixels, int width, int height) {
+	int iw = wallpaper->decoded_width;
+	int ih = wallpaper->decoded_height;
+	size_t stride_px = pixels->stride / 4;
+	int sx = 0, sy = 0, sw = iw, sh = ih;
+	int dx = 0, dy = 0, dw = width, dh = height;
+
+	switch (wallpaper->fit) {
+	case WALLPAPER_FILL:
+		/* Crop the image to the output's aspect ratio around its centre. */
+		if ((int64_t)iw * height > (int64_t)ih * width) {
+			sw = (int)((int64_t)ih * width / height);
+			sx = (iw - sw) / 2;
+		} else {
+			sh = (int)((int64_t)iw * height / width);
+			sy = (ih - sh) / 2;
+		}
+		break;
+	case WALLPAPER_FIT:
+		if ((int64_t)iw * height > (int64_t)ih * width) {
+			dh = (int)((int64_t)ih * width / iw);
+			dy = (height - dh) / 2;
+		} else {
+			dw = (int)((int64_t)iw * height / ih);
+			dx = (width - dw) / 2;
+		}
+		for (int y = 0; y < height; y++) {
+			uint32_t *row = pixels->data + (size_t)y * stride_px;
+			for (int x = 0; x < width; x++) {
+				row[x] = wallpaper->background;
+			}
+		}
+		break;
+	case WALLPAPER_STRETCH:
+	default:
+		break;
+	}
+	if (sw < 1) {
+		sw = 1;
+	}
+	if (sh < 1) {
+		sh = 1;
+	}
+	if (dw < 1) {
+		dw = 1;
+	}
+	if (dh < 1) {
+		dh = 1;
+	}
+	wallpaper_scale(wallpaper->decoded, iw, sx, sy, sw, sh,
+		pixels->data, stride_px, dx, dy, dw, dh);
+}
+
+static void wallpaper_run_job(struct flux_wallpaper *wallpaper, struct wallpaper_job *job) {
+	uint64_t start_nsec = monotonic_nsec();
+	if (!wallpaper->decoded && !wallpaper->decode_failed) {
+		wallpaper->decode_failed = !wallpaper_decode(wallpaper);
+	}
+	if (!wallpaper->decoded) {
+		return;
+	}
+
+	char final_path[PATH_MAX];
+	char tmp_path[PATH_MAX];
+	if (!wallpaper_pixels_alloc(wallpaper, job->width, job->height, &job->pixels,
+			final_path, tmp_path)) {
+		return;
+	}
+	wallpaper_render(wallpaper, &job->pixels, job->width, job->height);
+
+	struct wallpaper_cache_header header;
+	wallpaper_fill_header(wallpaper, job->width, job->height, job->pixels.stride, &header);
+	memcpy(job->pixels.map, &header, sizeof(header));
+	if (final_path[0] != '\0') {
+		if (rename(tmp_path, final_path) == 0) {
+			wallpaper_cache_prune(wallpaper, final_path);
+		} else {
+			wlr_log(WLR_ERROR, "wallpaper: failed to store cache %s: %s",
+				final_path, strerror(errno));
+			unlink(tmp_path);
+		}
+	}
+	job->ok = true;
+	job->scale_nsec = monotonic_nsec() - start_nsec;
+}
+
+static void *wallpaper_worker(void *data) {
+	struct flux_wallpaper *wallpaper = data;
+	pthread_mutex_lock(&wallpaper->lock);
+	while (!wallpaper->stopping) {
+		struct wallpaper_job *job = wallpaper->pending;
+		if (!job) {
+			pthread_cond_wait(&wallpaper->cond, &wallpaper->lock);
+			continue;
+		}
+		wallpaper->pending = job->next;
+		pthread_mutex_unlock(&wallpaper->lock);
+
+		wallpaper_run_job(wallpaper, job);
+
+		pthread_mutex_lock(&wallpaper->lock);
+		job->next = wallpaper->done;
+		wallpaper->done = job;
+		ssize_t written = write(wallpaper->notify_fds[1], "x", 1);
+		(void)written;
+	}
+	pthread_mutex_unlock(&wallpaper->lock);
+	return NULL;
+}
+
+static struct wallpaper_image *wallpaper_find_image(struct flux_wallpaper *wallpaper,
+		int width, int height) {
+	struct wallpaper_image *image;
+	wl_list_for_each(image, &wallpaper->images, link) {
+		if (image->width == width && image->height == height) {
+			return image;
+		}
+	}
+	return NULL;
+}
+
+static bool wallpaper_queue_job(struct flux_wallpaper *wallpaper, struct wallpaper_image *image) {
+	struct wallpaper_job *job = calloc(1, sizeof(*job));
+	if (!job) {
+		return false;
+	}
+	job->image = image;
+	job->width = image->width;
+	job->height = image->height;
+
+	pthread_mutex_lock(&wallpaper->lock);
+	if (!wallpaper->thread_started) {
+		if (pthread_create(&wallpaper->thread, NULL, wallpaper_worker, wallpaper) != 0) {
+			pthread_mutex_unlock(&wallpaper->lock);
+			free(job);
+			wlr_log(WLR_ERROR, "wallpaper: failed to start worker thread");
+			return false;
+		}
+		wallpaper->thread_started = true;
+	}
+	struct wallpaper_job **tail = &wallpaper->pending;
+	while (*tail) {
+		tail = &(*tail)->next;
+	}
+	*tail = job;
+	pthread_cond_signal(&wallpaper->cond);
+	pthread_mutex_unlock(&wallpaper->lock);
+	return true;
+}
+
+static struct wallpaper_image *wallpaper_get_image(struct flux_wallpaper *wallpaper,
+		int width, int height) {
+	struct wallpaper_image *image = wallpaper_find_image(wallpaper, width, height);
+	if (image) {
+		return image;
+	}
+
+	image = calloc(1, sizeof(*image));
+	if (!image) {
+		return NULL;
+	}
+	image->width = width;
+	image->height = height;
+	wl_list_insert(&wallpaper->images, &image->link);
+
+	struct wallpaper_pixels pixels = {0};
+	if (wallpaper_cache_map(wallpaper, width, height, &pixels)) {
+		image->buffer = wallpaper_buffer_create(width, height, &pixels);
+		if (!image->buffer) {
+			wallpaper_pixels_release(&pixels);
+			image->failed = true;
+		} else {
+			wlr_log(WLR_INFO, "wallpaper %dx%d mapped from cache", width, height);
+		}
+	} else if (wallpaper_queue_job(wallpaper, image)) {
+		image->queued = true;
+	} else {
+		image->failed = true;
+	}
+	return image;
+}
+
+static void wallpaper_image_maybe_free(struct wallpaper_image *image) {
+	if (image->users > 0 || image->queued) {
+		return;
+	}
+	wlr_log(WLR_DEBUG, "wallpaper %dx%d no longer used", image->width, image->height);
+	if (image->buffer) {
+		wlr_buffer_drop(&image->buffer->base);
+	}
+	wl_list_remove(&image->link);
+	free(image);
+}
+
+/* Points the output at image, releasing the size it showed before. */
+static void wallpaper_output_set_image(struct flux_output *output,
+		struct wallpaper_image *image) {
+	struct wallpaper_image *old = output->wallpaper_image;
+	if (old == image) {
+		return;
+	}
+	if (image) {
+		image->users++;
+	}
+	output->wallpaper_image = image;
+	if (old) {
+		old->users--;
+		wallpaper_image_maybe_free(old);
+	}
+}
+
+static void wallpaper_apply(struct flux_output *output) {
+	struct flux_wallpaper *wallpaper = output->server->wallpaper;
+	if (!wallpaper || !output->background_rect) {
+		return;
+	}
+
+	struct wlr_box box = {0};
+	wlr_output_layout_get_box(output->server->output_layout, output->wlr_output, &box);
+	if (box.width <= 0 || box.height <= 0) {
+		return;
+	}
+	int width = (int)lround(box.width * output->wlr_output->scale);
+	int height = (int)lround(box.height * output->wlr_output->scale);
+	if (width <= 0 || height <= 0 ||
+			width > WALLPAPER_MAX_DIMENSION || height > WALLPAPER_MAX_DIMENSION) {
+		return;
+	}
+
+	struct wallpaper_image *image = wallpaper_get_image(wallpaper, width, height);
+	struct wlr_buffer *buffer = image && image->buffer ? &image->buffer->base : NULL;
+	if (!output->wallpaper_node) {
+		output->wallpaper_node = wlr_scene_buffer_create(&output->server->scene->tree, NULL);
+		if (!output->wallpaper_node) {
+			return;
+		}
+		wlr_scene_node_set_enabled(&output->wallpaper_node->node,
+			output->background_rect->node.enabled);
+		wlr_scene_buffer_set_filter_mode(output->wallpaper_node,
+			render_profile_scale_filter(output->server));
+	}
+	/* Until the image is ready the solid background shows through. */
+	wlr_scene_buffer_set_buffer(output->wallpaper_node, buffer);
+	wallpaper_output_set_image(output, image);
+	wlr_scene_buffer_set_dest_size(output->wallpaper_node, box.width, box.height);
+	wlr_scene_node_set_position(&output->wallpaper_node->node, box.x, box.y);
+	wlr_scene_node_place_above(&output->wallpaper_node->node,
+		&output->background_rect->node);
+}
+
+static int wallpaper_notify(int fd, uint32_t mask, void *data) {
+	(void)mask;
+	struct flux_wallpaper *wallpaper = data;
+	char drain[64];
+	while (read(fd, drain, sizeof(drain)) > 0) {
+	}
+
+	pthread_mutex_lock(&wallpaper->lock);
+	struct wallpaper_job *done = wallpaper->done;
+	wallpaper->done = NULL;
+	pthread_mutex_unlock(&wallpaper->lock);
+
+	bool any_ready = false;
+	while (done) {
+		struct wallpaper_job *job = done;
+		done = job->next;
+		struct wallpaper_image *image = job->image;
+		image->queued = false;
+		if (job->ok) {
+			image->buffer = wallpaper_buffer_create(job->width, job->height, &job->pixels);
+		}
+		if (image->buffer) {
+			wlr_log(WLR_INFO, "wallpaper %dx%d scaled in %.1fms (%s)",
+				job->width, job->height, job->scale_nsec / 1000000.0,
+				image->buffer->pixels.mapped ? "cached" : "not cached");
+			any_ready = true;
+		} else {
+			image->failed = true;
+		}
+		wallpaper_pixels_release(&job->pixels);
+		free(job);
+		/* Every output moved to another size while this one was scaling. */
+		wallpaper_image_maybe_free(image);
+	}
+
+	if (any_ready) {
+		struct flux_output *output;
+		wl_list_for_each(output, &wallpaper->server->outputs, link) {
+			wallpaper_apply(output);
+		}
+	}
+	return 0;
+}
+
+void wallpaper_output_update(struct flux_output *output) {
+	wallpaper_apply(output);
+}
+
+void wallpaper_output_destroy(struct flux_output *output) {
+	if (output->wallpaper_node) {
+		wlr_scene_node_destroy(&output->wallpaper_node->node);
+		output->wallpaper_node = NULL;
+	}
+	wallpaper_output_set_image(output, NULL);
+}
+
+static enum wallpaper_fit parse_wallpaper_fit(void) {
+	const char *value = getenv("FLUX_WALLPAPER_MODE");
+	if (!value || value[0] == '\0' || strcmp(value, "fill") == 0) {
+		return WALLPAPER_FILL;
+	}
+	if (strcmp(value, "fit") == 0) {
+		return WALLPAPER_FIT;
+	}
+	if (strcmp(value, "stretch") == 0) {
+		return WALLPAPER_STRETCH;
+	}
+	wlr_log(WLR_ERROR, "ignoring invalid FLUX_WALLPAPER_MODE '%s'", value);
+	return WALLPAPER_FILL;
+}
+
+bool wallpaper_init(struct flux_server *server) {
+	const char *path = getenv("FLUX_WALLPAPER");
+	if (!path || path[0] == '\0') {
+		return true;
+	}
+
+	struct flux_wallpaper *wallpaper = calloc(1, sizeof(*wallpaper));
+	if (!wallpaper) {
+		return false;
+	}
+	if (!realpath(path, wallpaper->path) || stat(wallpaper->path, &wallpaper->source) != 0) {
+		wlr_log(WLR_ERROR, "wallpaper: cannot access %s: %s", path, strerror(errno));
+		free(wallpaper);
+		return true;
+	}
+	wallpaper->server = server;
+	wallpaper->fit = parse_wallpaper_fit();
+	wallpaper->background = color_to_xrgb(COLOR_BACKGROUND);
+	wallpaper->key = fnv1a(0xcbf29ce484222325ull, wallpaper->path, strlen(wallpaper->path));
+	wl_list_init(&wallpaper->images);
+
+	if (pipe(wallpaper->notify_fds) != 0) {
+		wlr_log(WLR_ERROR, "wallpaper: pipe failed: %s", strerror(errno));
+		free(wallpaper);
+		return false;
+	}
+	for (int i = 0; i < 2; i++) {
+		fcntl(wallpaper->notify_fds[i], F_SETFD, FD_CLOEXEC);
+		fcntl(wallpaper->notify_fds[i], F_SETFL, O_NONBLOCK);
+	}
+	pthread_mutex_init(&wallpaper->lock, NULL);
+	pthread_cond_init(&wallpaper->cond, NULL);
+	wallpaper->notify_source = wl_event_loop_add_fd(
+		wl_display_get_event_loop(server->display), wallpaper->notify_fds[0],
+		WL_EVENT_READABLE, wallpaper_notify, wallpaper);
+	if (!wallpaper->notify_source) {
+		close(wallpaper->notify_fds[0]);
+		close(wallpaper->notify_fds[1]);
+		pthread_mutex_destroy(&wallpaper->lock);
+		pthread_cond_destroy(&wallpaper->cond);
+		free(wallpaper);
+		return false;
+	}
+
+	server->wallpaper = wallpaper;
+	wlr_log(WLR_INFO, "wallpaper %s (%s)", wallpaper->path, fit_name(wallpaper->fit));
+	return true;
+}
+
+void wallpaper_finish(struct flux_server *server) {
+	struct flux_wallpaper *wallpaper = server->wallpaper;
+	if (!wallpaper) {
+		return;
+	}
+
+	pthread_mutex_lock(&wallpaper->lock);
+	wallpaper->stopping = true;
+	pthread_cond_signal(&wallpaper->cond);
+	pthread_mutex_unlock(&wallpaper->lock);
+	if (wallpaper->thread_started) {
+		pthread_join(wallpaper->thread, NULL);
+	}
+	free(wallpaper->decoded);
+
+	struct wallpaper_job *lists[] = { wallpaper->pending, wallpaper->done };
+	for (size_t i = 0; i < sizeof(lists) / sizeof(lists[0]); i++) {
+		while (lists[i]) {
+			struct wallpaper_job *job = lists[i];
+			lists[i] = job->next;
+			wallpaper_pixels_release(&job->pixels);
+			free(job);
+		}
+	}
+
+	struct wallpaper_image *image, *tmp;
+	wl_list_for_each_safe(image, tmp, &wallpaper->images, link) {
+		if (image->buffer) {
+			wlr_buffer_drop(&image->buffer->base);
+		}
+		wl_list_remove(&image->link);
+		free(image);
+	}
+
+	wl_event_source_remove(wallpaper->notify_source);
+	close(wallpaper->notify_fds[0]);
+	close(wallpaper->notify_fds[1]);
+	pthread_mutex_destroy(&wallpaper->lock);
+	pthread_cond_destroy(&wallpaper->cond);
+	free(wallpaper);
+	server->wallpaper = NULL;
+}
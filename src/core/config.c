@@ -45,3 +45,201 @@ uint32_t parse_keybind_mod_mask(void) {
 	// Safe default for mixed desktop/VM setups.
 	return WLR_MODIFIER_ALT | WLR_MODIFIER_LOGO;
 }
+
+bool env_output_value(const char *list_name, const char *global_name,
+		const char *output_name, char *out, size_t out_len) {
+	/* Per-output entries look like "DP-1:on,HDMI-A-1:off". */
+	const char *list = getenv(list_name);
+	size_t name_len = output_name ? strlen(output_name) : 0;
+	if (list && list[0] != '\0' && name_len > 0) {
+		const char *entry = list;
+		while (*entry != '\0') {
+			const char *end = strchr(entry, ',');
+			size_t entry_len = end ? (size_t)(end - entry) : strlen(entry);
+			if (entry_len > name_len && entry[name_len] == ':' &&
+					strncmp(entry, output_name, name_len) == 0) {
+				size_t value_len = entry_len - name_len - 1;
+				if (value_len >= out_len) {
+					value_len = out_len - 1;
+				}
+				memcpy(out, entry + name_len + 1, value_len);
+				out[value_len] = '\0';
+				return true;
+			}
+			if (!end) {
+				break;
+			}
+			entry = end + 1;
+		}
+	}
+
+	const char *global = global_name ? getenv(global_name) : NULL;
+	if (global && global[0] != '\0') {
+		snprintf(out, out_len, "%s", global);
+		return true;
+	}
+	return false;
+}
+
+enum flux_vrr_mode parse_vrr_mode(const char *output_name) {
+	char value[32];
+	if (!env_output_value("FLUX_VRR_OUTPUTS", "FLUX_VRR", output_name,
+			value, sizeof(value))) {
+		return FLUX_VRR_OFF;
+	}
+
+	if (strcmp(value, "on") == 0 || strcmp(value, "1") == 0 ||
+			strcmp(value, "always") == 0) {
+		return FLUX_VRR_ON;
+	}
+	if (strcmp(value, "auto") == 0) {
+		return FLUX_VRR_AUTO;
+	}
+	return FLUX_VRR_OFF;
+}
+
+/* Millisecond knobs accept "<ms>", "auto" or "off"; invalid values mean off. */
+static int parse_msec_knob(const char *list_name, const char *global_name,
+		const char *output_name, const char *what) {
+	char value[32];
+	if (!env_output_value(list_name, global_name, output_name, value, sizeof(value))) {
+		return 0;
+	}
+
+	if (strcmp(value, "auto") == 0) {
+		return FLUX_MSEC_AUTO;
+	}
+	if (strcmp(value, "off") == 0) {
+		return 0;
+	}
+
+	char *end = NULL;
+	long msec = strtol(value, &end, 10);
+	if (end == value || *end != '\0' || msec <= 0 || msec > 1000) {
+		wlr_log(WLR_ERROR, "ignoring invalid %s '%s' for %s",
+			what, value, output_name);
+		return 0;
+	}
+	return (int)msec;
+}
+
+int parse_max_render_time(const char *output_name) {
+	return parse_msec_knob("FLUX_MAX_RENDER_TIME_OUTPUTS", "FLUX_MAX_RENDER_TIME",
+		output_name, "max render time");
+}
+
+int parse_frame_done_delay(const char *output_name) {
+	return parse_msec_knob("FLUX_FRAME_DONE_DELAY_OUTPUTS", "FLUX_FRAME_DONE_DELAY",
+		output_name, "frame-done delay");
+}
+
+enum flux_render_profile parse_render_profile(void) {
+	const char *value = getenv("FLUX_RENDER_PROFILE");
+	if (!value || value[0] == '\0' || strcmp(value, "auto") == 0) {
+		return FLUX_RENDER_PROFILE_AUTO;
+	}
+	if (strcmp(value, "full") == 0) {
+		return FLUX_RENDER_PROFILE_FULL;
+	}
+	if (strcmp(value, "low-power") == 0) {
+		return FLUX_RENDER_PROFILE_LOW_POWER;
+	}
+	wlr_log(WLR_ERROR, "ignoring invalid FLUX_RENDER_PROFILE '%s'", value);
+	return FLUX_RENDER_PROFILE_AUTO;
+}
+
+/* Frame-rate cap under the low-power profile; 0 means uncapped. */
+int parse_low_power_fps(const char *output_name) {
+	char value[32];
+	if (!env_output_value("FLUX_LOW_POWER_FPS_OUTPUTS", "FLUX_LOW_POWER_FPS", output_name,
+			value, sizeof(value))) {
+		return 30;
+	}
+	if (strcmp(value, "off") == 0) {
+		return 0;
+	}
+
+	char *end = NULL;
+	long fps = strtol(value, &end, 10);
+	if (end == value || *end != '\0' || fps <= 0 || fps > 1000) {
+		wlr_log(WLR_ERROR, "ignoring invalid low-power fps '%s' for %s", value, output_name);
+		return 30;
+	}
+	return (int)fps;
+}
+
+bool env_list_contains(const char *list_name, const char *item) {
+	const char *list = getenv(list_name);
+	size_t item_len = item ? strlen(item) : 0;
+	if (!list || item_len == 0) {
+		return false;
+	}
+
+	const char *entry = list;
+	while (*entry != '\0') {
+		const char *end = strchr(entry, ',');
+		size_t entry_len = end ? (size_t)(end - entry) : strlen(entry);
+		if (entry_len == item_len && strncmp(entry, item, item_len) == 0) {
+			return true;
+		}
+		if (!end) {
+			break;
+		}
+		entry = end + 1;
+	}
+	return false;
+}
+
+void parse_output_mode(const char *output_name, struct flux_mode_request *out) {
+	memset(out, 0, sizeof(*out));
+	out->policy = FLUX_MODE_PREFERRED;
+
+	char value[64];
+	if (!env_output_value("FLUX_OUTPUT_MODE_OUTPUTS", "FLUX_OUTPUT_MODE",
+			output_name, value, sizeof(value))) {
+		return;
+	}
+
+	if (strcmp(value, "preferred") == 0) {
+		return;
+	}
+	if (strcmp(value, "highest-refresh") == 0 || strcmp(value, "max") == 0) {
+		out->policy = FLUX_MODE_HIGHEST_REFRESH;
+		return;
+	}
+	if (strcmp(value, "low-power") == 0 || strcmp(value, "min") == 0) {
+		out->policy = FLUX_MODE_LOW_POWER;
+		return;
+	}
+
+	/* Explicit modes look like "2560x1440@143.91" or "1920x1080". */
+	int width = 0, height = 0;
+	double refresh_hz = 0.0;
+	int consumed = 0;
+	int fields = sscanf(value, "%dx%d%n@%lf%n", &width, &height, &consumed,
+		&refresh_hz, &consumed);
+	if (fields < 2 || value[consumed] != '\0' || width <= 0 || height <= 0 ||
+			refresh_hz < 0.0) {
+		wlr_log(WLR_ERROR, "ignoring invalid output mode '%s' for %s",
+			value, output_name);
+		return;
+	}
+	out->policy = FLUX_MODE_EXPLICIT;
+	out->width = width;
+	out->height = height;
+	out->refresh_mhz = (int32_t)lround(refresh_hz * 1000.0);
+}
+
+bool parse_mirror_source(const char *output_name, char *out, size_t out_len) {
+	/* Mirrors are listed as "DST:SRC", e.g. "HDMI-A-1:eDP-1". */
+	if (!env_output_value("FLUX_MIRROR_OUTPUTS", NULL, output_name, out, out_len) ||
+			out[0] == '\0') {
+		return false;
+	}
+	if (strcmp(out, output_name) == 0) {
+		wlr_log(WLR_ERROR, "ignoring output %s mirroring itself", output_name);
+		out[0] = '\0';
+		return false;
+	}
+	return true;
+}
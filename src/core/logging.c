@@ -26,7 +26,7 @@ static void timestamp_now(char out[32]) {
 	strftime(out, 32, "%Y-%m-%d %H:%M:%S", &tm);
 }
 
-static void create_parent_dirs(const char *path) {
+void create_parent_dirs(const char *path) {
 	if (!path || path[0] == '\0') {
 		return;
 	}
@@ -1,5 +1,7 @@
 #include "flux.h"
 
+#include <wlr/render/pixman.h>
+
 static bool env_is_set(const char *name) {
 	const char *value = getenv(name);
 	return value && value[0] != '\0';
@@ -47,6 +49,21 @@ static void enable_dumb_graphics_environment(bool force_pixman_renderer) {
 	}
 }
 
+static void resolve_render_profile(struct flux_server *server) {
+	enum flux_render_profile requested = parse_render_profile();
+	const char *reason = "forced";
+	if (requested == FLUX_RENDER_PROFILE_AUTO) {
+		bool pixman = wlr_renderer_is_pixman(server->renderer);
+		server->render_profile = pixman ? FLUX_RENDER_PROFILE_LOW_POWER : FLUX_RENDER_PROFILE_FULL;
+		reason = pixman ? "auto: pixman renderer" : "auto: hardware renderer";
+	} else {
+		server->render_profile = requested;
+	}
+	wlr_log(WLR_INFO, "render profile: %s (%s)",
+		server->render_profile == FLUX_RENDER_PROFILE_LOW_POWER ? "low-power" : "full",
+		reason);
+}
+
 static void configure_client_environment_defaults(void) {
 	/*
 	 * Let clients keep their own decoration policy.
@@ -94,6 +111,7 @@ int main(void) {
 	wl_list_init(&server.outputs);
 	wl_list_init(&server.keyboards);
 	wl_list_init(&server.views);
+	wl_list_init(&server.paced_surfaces);
 	server.cursor_hotspot_x = env_int("FLUX_CURSOR_HOTSPOT_X", 0);
 	server.cursor_hotspot_y = env_int("FLUX_CURSOR_HOTSPOT_Y", 0);
 	bool on_parallels = running_on_parallels();
@@ -102,6 +120,7 @@ int main(void) {
 	server.keybind_mod_mask = parse_keybind_mod_mask();
 	server.use_drawn_cursor = on_parallels;
 	server.cursor_mode = CURSOR_PASSTHROUGH;
+	server.coalesce_motion = env_int("FLUX_POINTER_COALESCE", 1) != 0;
 
 	if (on_parallels && !dumb_graphics_mode) {
 		wlr_log(WLR_INFO, "Parallels VM detected; forcing dumb graphics mode for pointer stability");
@@ -128,9 +147,14 @@ int main(void) {
 		wlr_log(WLR_INFO, "startup detected Parallels VM; enabling drawn-cursor compatibility");
 	}
 
+	if (env_int("WLR_NO_HARDWARE_CURSORS", 0) != 0) {
+		no_hw_cursors = true;
+	}
 	if (no_hw_cursors) {
 		setenv("WLR_NO_HARDWARE_CURSORS", "1", 1);
 	}
+	/* Planes are off exactly where the scene-node pointer is needed. */
+	server.cursor_plane = !no_hw_cursors && env_int("FLUX_CURSOR_PLANE", 1) != 0;
 
 	wlr_log(WLR_INFO, "hardware cursor planes: %s",
 		no_hw_cursors ? "disabled" : "enabled");
@@ -138,8 +162,11 @@ int main(void) {
 	wlr_log(WLR_INFO, "renderer backend requested: %s",
 		renderer_env && renderer_env[0] != '\0' ? renderer_env : "autocreate");
 	wlr_log(WLR_INFO, "keybind modifier mask: 0x%x", server.keybind_mod_mask);
-	wlr_log(WLR_INFO, "cursor mode: %s",
-		server.use_drawn_cursor ? "drawn" : "theme/client");
+	wlr_log(WLR_INFO, "cursor mode: %s, custom cursor via %s",
+		server.use_drawn_cursor ? "drawn" : "theme/client",
+		server.cursor_plane ? "wlr_cursor" : "scene");
+	wlr_log(WLR_INFO, "pointer motion: %s",
+		server.coalesce_motion ? "coalesced per frame" : "per event");
 	configure_client_environment_defaults();
 
 	server.display = wl_display_create();
@@ -153,7 +180,9 @@ int main(void) {
 		event_loop, SIGINT, handle_terminate_signal, &server);
 	server.sigterm_source = wl_event_loop_add_signal(
 		event_loop, SIGTERM, handle_terminate_signal, &server);
-	if (!server.sigint_source || !server.sigterm_source) {
+	server.sigusr1_source = wl_event_loop_add_signal(
+		event_loop, SIGUSR1, handle_frame_stats_signal, &server);
+	if (!server.sigint_source || !server.sigterm_source || !server.sigusr1_source) {
 		wlr_log(WLR_ERROR, "failed to register signal handlers");
 		wl_display_destroy(server.display);
 		return 1;
@@ -175,6 +204,7 @@ int main(void) {
 			enable_dumb_graphics_environment(true);
 			no_hw_cursors = true;
 			server.use_drawn_cursor = true;
+			server.cursor_plane = false;
 			if (!create_renderer_and_allocator(&server)) {
 				wlr_log(WLR_ERROR, "dumb graphics fallback failed");
 			}
@@ -191,6 +221,14 @@ int main(void) {
 	const char *active_renderer = getenv("WLR_RENDERER");
 	wlr_log(WLR_INFO, "renderer backend env after init: %s",
 		active_renderer && active_renderer[0] != '\0' ? active_renderer : "autocreate");
+	resolve_render_profile(&server);
+
+	if (!soft_compositor_init(&server)) {
+		wlr_log(WLR_ERROR, "failed to set up the software compositor");
+		wlr_backend_destroy(server.backend);
+		wl_display_destroy(server.display);
+		return 1;
+	}
 
 	wlr_compositor_create(server.display, 6, server.renderer);
 	server.subcompositor = wlr_subcompositor_create(server.display);
@@ -207,24 +245,65 @@ int main(void) {
 	server.fractional_scale_v1 =
 		wlr_fractional_scale_manager_v1_create(server.display, 1);
 	server.cursor_shape_v1 = wlr_cursor_shape_manager_v1_create(server.display, 1);
+	server.relative_pointer_v1 = wlr_relative_pointer_manager_v1_create(server.display);
 	server.text_input_v3 = wlr_text_input_manager_v3_create(server.display);
 	server.input_method_v2 = wlr_input_method_manager_v2_create(server.display);
 	server.xdg_decoration_v1 = wlr_xdg_decoration_manager_v1_create(server.display);
+	/* Scene outputs send wp_presentation feedback once the global exists. */
+	server.presentation = wlr_presentation_create(server.display, server.backend, 2);
+	server.tearing_control_v1 = wlr_tearing_control_manager_v1_create(server.display, 1);
+	server.single_pixel_buffer_v1 = wlr_single_pixel_buffer_manager_v1_create(server.display);
 	if (!server.primary_selection_v1 || !server.xdg_activation_v1 ||
 			!server.viewporter || !server.fractional_scale_v1 ||
-			!server.cursor_shape_v1 || !server.text_input_v3 ||
-			!server.input_method_v2 || !server.xdg_decoration_v1) {
+			!server.cursor_shape_v1 || !server.relative_pointer_v1 ||
+			!server.text_input_v3 ||
+			!server.input_method_v2 || !server.xdg_decoration_v1 ||
+			!server.presentation || !server.tearing_control_v1 ||
+			!server.single_pixel_buffer_v1) {
 		wlr_log(WLR_ERROR, "failed to create one or more protocol managers");
 		wlr_backend_destroy(server.backend);
 		wl_display_destroy(server.display);
 		return 1;
 	}
 	wlr_data_device_manager_create(server.display);
+	if (!idle_init(&server)) {
+		wlr_log(WLR_ERROR, "failed to set up idle handling");
+		wlr_backend_destroy(server.backend);
+		wl_display_destroy(server.display);
+		return 1;
+	}
+	if (!capture_init(&server)) {
+		wlr_log(WLR_ERROR, "failed to create screen capture globals");
+		wlr_backend_destroy(server.backend);
+		wl_display_destroy(server.display);
+		return 1;
+	}
+	if (!wallpaper_init(&server)) {
+		wlr_log(WLR_ERROR, "failed to set up wallpaper loading");
+		wlr_backend_destroy(server.backend);
+		wl_display_destroy(server.display);
+		return 1;
+	}
+	if (!pacing_init(&server)) {
+		wlr_log(WLR_ERROR, "failed to create fifo and commit-timing managers");
+		wlr_backend_destroy(server.backend);
+		wl_display_destroy(server.display);
+		return 1;
+	}
+
+	server.spatial_index = spatial_index_create();
+	if (!server.spatial_index) {
+		wlr_log(WLR_ERROR, "failed to allocate the hit-test index");
+		wlr_backend_destroy(server.backend);
+		wl_display_destroy(server.display);
+		return 1;
+	}
 
 	server.output_layout = wlr_output_layout_create(server.display);
+	server.output_layout_change.notify = output_layout_change_notify;
+	wl_signal_add(&server.output_layout->events.change, &server.output_layout_change);
 	server.scene = wlr_scene_create();
 	wlr_scene_attach_output_layout(server.scene, server.output_layout);
-	taskbar_init(&server);
 
 	server.seat = wlr_seat_create(server.display, "seat0");
 	server.cursor = wlr_cursor_create();
@@ -245,6 +324,13 @@ int main(void) {
 	} else {
 		apply_default_cursor(&server);
 	}
+	damage_debug_init(&server);
+	if (!hud_init(&server)) {
+		wlr_log(WLR_ERROR, "failed to set up the frame-time HUD");
+		wlr_backend_destroy(server.backend);
+		wl_display_destroy(server.display);
+		return 1;
+	}
 
 	server.xdg_shell = wlr_xdg_shell_create(server.display, 3);
 
@@ -301,6 +387,11 @@ int main(void) {
 
 	wl_display_destroy_clients(server.display);
 	wlr_backend_destroy(server.backend);
+	wallpaper_finish(&server);
+	soft_compositor_finish(&server);
+	cursor_finish(&server);
+	spatial_index_destroy(server.spatial_index);
+	server.spatial_index = NULL;
 	wl_display_destroy(server.display);
 	wlr_log(WLR_INFO, "flux compositor exited");
 	return 0;
@@ -5,7 +5,8 @@ const float COLOR_TITLE_INACTIVE[4] = {0.21f, 0.21f, 0.21f, 1.0f};
 const float COLOR_BORDER[4] = {0.08f, 0.08f, 0.08f, 1.0f};
 const float COLOR_MIN_BUTTON[4] = {0.96f, 0.77f, 0.17f, 1.0f};
 const float COLOR_BACKGROUND[4] = {0.0f, 0.5019608f, 0.5019608f, 1.0f};
-const float COLOR_TASKBAR_BG[4] = {0.01f, 0.16f, 0.16f, 0.96f};
+/* Opaque so the scene can cull what is underneath instead of blending. */
+const float COLOR_TASKBAR_BG[4] = {0.01f, 0.16f, 0.16f, 1.0f};
 const float COLOR_TASKBAR_BUTTON[4] = {0.08f, 0.23f, 0.23f, 1.0f};
 const float COLOR_TASKBAR_TEXT[4] = {0.95f, 0.97f, 0.97f, 1.0f};
 const float COLOR_CURSOR_BLACK[4] = {0.03f, 0.03f, 0.03f, 1.0f};
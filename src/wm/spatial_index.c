@@ -0,0 +1,230 @@
+#include "flux.h"
+
+/*
+ * Uniform grid over layout coordinates for pointer hit-testing. Each layer
+ * holds one box per view (the grab-padded frame, or the taskbar button) and
+ * every cell lists the views whose box overlaps it, topmost first by
+ * stack_seq. A query returns the point's cell; callers test exact geometry
+ * and take the first match, so the grid only has to be a superset of the
+ * real hits.
+ *
+ * This file only deals in boxes: view.c and taskbar.c decide what each view
+ * covers and keep it current.
+ */
+
+#define SPATIAL_CELL_SIZE 256
+
+struct spatial_cell {
+	struct flux_view **views;
+	size_t count;
+	size_t capacity;
+};
+
+struct spatial_grid {
+	struct spatial_cell *cells;
+};
+
+struct flux_spatial_index {
+	struct wlr_box bounds;
+	int cols;
+	int rows;
+	/* Bumped on reset so slots filled against older cells are ignored. */
+	uint32_t generation;
+	/* An allocation failed: queries fall back to a full walk until reset. */
+	bool broken;
+	struct spatial_grid layers[FLUX_SPATIAL_LAYERS];
+};
+
+static void grid_free(struct flux_spatial_index *index, struct spatial_grid *grid) {
+	if (!grid->cells) {
+		return;
+	}
+	for (int i = 0; i < index->cols * index->rows; i++) {
+		free(grid->cells[i].views);
+	}
+	free(grid->cells);
+	grid->cells = NULL;
+}
+
+struct flux_spatial_index *spatial_index_create(void) {
+	struct flux_spatial_index *index = calloc(1, sizeof(*index));
+	if (!index) {
+		return NULL;
+	}
+	index->generation = 1;
+	return index;
+}
+
+void spatial_index_destroy(struct flux_spatial_index *index) {
+	if (!index) {
+		return;
+	}
+	for (int layer = 0; layer < FLUX_SPATIAL_LAYERS; layer++) {
+		grid_free(index, &index->layers[layer]);
+	}
+	free(index);
+}
+
+void spatial_index_reset(struct flux_spatial_index *index, const struct wlr_box *bounds) {
+	for (int layer = 0; layer < FLUX_SPATIAL_LAYERS; layer++) {
+		grid_free(index, &index->layers[layer]);
+	}
+	index->generation++;
+	index->broken = false;
+	index->cols = 0;
+	index->rows = 0;
+	index->bounds = (struct wlr_box){0};
+	if (!bounds || bounds->width <= 0 || bounds->height <= 0) {
+		return;
+	}
+
+	int cols = (bounds->width + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+	int rows = (bounds->height + SPATIAL_CELL_SIZE - 1) / SPATIAL_CELL_SIZE;
+	for (int layer = 0; layer < FLUX_SPATIAL_LAYERS; layer++) {
+		index->layers[layer].cells = calloc((size_t)cols * (size_t)rows,
+			sizeof(struct spatial_cell));
+		if (!index->layers[layer].cells) {
+			index->broken = true;
+		}
+	}
+	index->bounds = *bounds;
+	index->cols = cols;
+	index->rows = rows;
+}
+
+static struct spatial_cell *grid_cell(struct flux_spatial_index *index,
+		struct spatial_grid *grid, int col, int row) {
+	return &grid->cells[(size_t)row * (size_t)index->cols + (size_t)col];
+}
+
+static void cell_remove(struct spatial_cell *cell, struct flux_view *view) {
+	for (size_t i = 0; i < cell->count; i++) {
+		if (cell->views[i] == view) {
+			memmove(&cell->views[i], &cell->views[i + 1],
+				(cell->count - i - 1) * sizeof(*cell->views));
+			cell->count--;
+			return;
+		}
+	}
+}
+
+static bool cell_add(struct spatial_cell *cell, struct flux_view *view) {
+	if (cell->count == cell->capacity) {
+		size_t capacity = cell->capacity ? cell->capacity * 2 : 8;
+		struct flux_view **views = realloc(cell->views, capacity * sizeof(*views));
+		if (!views) {
+			return false;
+		}
+		cell->views = views;
+		cell->capacity = capacity;
+	}
+	/* Raised views land at the front, so this rarely walks far. */
+	size_t pos = 0;
+	while (pos < cell->count && cell->views[pos]->stack_seq > view->stack_seq) {
+		pos++;
+	}
+	memmove(&cell->views[pos + 1], &cell->views[pos],
+		(cell->count - pos) * sizeof(*cell->views));
+	cell->views[pos] = view;
+	cell->count++;
+	return true;
+}
+
+static int clamp_int(int value, int min_value, int max_value) {
+	return value < min_value ? min_value : (value > max_value ? max_value : value);
+}
+
+void spatial_index_set(struct flux_spatial_index *index, enum flux_spatial_layer layer,
+		struct flux_view *view, const struct wlr_box *box) {
+	struct flux_spatial_slot *slot = &view->spatial[layer];
+	struct spatial_grid *grid = &index->layers[layer];
+	bool current = slot->indexed && slot->generation == index->generation;
+
+	/* Clip to the grid; boxes entirely off the layout can never be hit. */
+	struct flux_spatial_slot next = {0};
+	if (box && box->width > 0 && box->height > 0 && grid->cells) {
+		const struct wlr_box *b = &index->bounds;
+		int x1 = box->x + box->width;
+		int y1 = box->y + box->height;
+		if (x1 > b->x && y1 > b->y &&
+				box->x < b->x + b->width && box->y < b->y + b->height) {
+			next.indexed = true;
+			next.generation = index->generation;
+			next.col0 = clamp_int((box->x - b->x) / SPATIAL_CELL_SIZE, 0, index->cols - 1);
+			next.row0 = clamp_int((box->y - b->y) / SPATIAL_CELL_SIZE, 0, index->rows - 1);
+			next.col1 = clamp_int((x1 - 1 - b->x) / SPATIAL_CELL_SIZE, 0, index->cols - 1);
+			next.row1 = clamp_int((y1 - 1 - b->y) / SPATIAL_CELL_SIZE, 0, index->rows - 1);
+		}
+	}
+
+	/* Moves inside the same cells, the common case while dragging, are free. */
+	if (current == next.indexed && (!current || (slot->col0 == next.col0 &&
+			slot->row0 == next.row0 && slot->col1 == next.col1 && slot->row1 == next.row1))) {
+		return;
+	}
+
+	if (current) {
+		for (int row = slot->row0; row <= slot->row1; row++) {
+			for (int col = slot->col0; col <= slot->col1; col++) {
+				cell_remove(grid_cell(index, grid, col, row), view);
+			}
+		}
+	}
+	*slot = next;
+	if (!next.indexed) {
+		return;
+	}
+	for (int row = next.row0; row <= next.row1; row++) {
+		for (int col = next.col0; col <= next.col1; col++) {
+			if (!cell_add(grid_cell(index, grid, col, row), view)) {
+				index->broken = true;
+			}
+		}
+	}
+}
+
+/* Re-sorts a view whose stack_seq changed within the cells it occupies. */
+void spatial_index_restack(struct flux_spatial_index *index, struct flux_view *view) {
+	for (int layer = 0; layer < FLUX_SPATIAL_LAYERS; layer++) {
+		struct flux_spatial_slot *slot = &view->spatial[layer];
+		if (!slot->indexed || slot->generation != index->generation) {
+			continue;
+		}
+		struct spatial_grid *grid = &index->layers[layer];
+		for (int row = slot->row0; row <= slot->row1; row++) {
+			for (int col = slot->col0; col <= slot->col1; col++) {
+				struct spatial_cell *cell = grid_cell(index, grid, col, row);
+				cell_remove(cell, view);
+				if (!cell_add(cell, view)) {
+					index->broken = true;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Candidates for a point, topmost first: false when the grid cannot answer (no layout, point
+ * off the layout, or out of memory) and the caller must walk every view.
+ */
+bool spatial_index_query(const struct flux_spatial_index *index,
+		enum flux_spatial_layer layer, double lx, double ly,
+		struct flux_view *const **views, size_t *count) {
+	*views = NULL;
+	*count = 0;
+	const struct spatial_grid *grid = &index->layers[layer];
+	if (index->broken || !grid->cells) {
+		return false;
+	}
+	double x = lx - index->bounds.x;
+	double y = ly - index->bounds.y;
+	if (x < 0.0 || y < 0.0 || x >= index->bounds.width || y >= index->bounds.height) {
+		return false;
+	}
+	const struct spatial_cell *cell = &grid->cells[
+		(size_t)((int)y / SPATIAL_CELL_SIZE) * (size_t)index->cols +
+		(size_t)((int)x / SPATIAL_CELL_SIZE)];
+	*views = cell->views;
+	*count = cell->count;
+	return true;
+}
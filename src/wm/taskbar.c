@@ -78,7 +78,7 @@ static const struct glyph_5x7 GLYPHS[] = {
 static const uint8_t EMPTY_GLYPH[TASKBAR_GLYPH_H] = {0, 0, 0, 0, 0, 0, 0};
 static const uint8_t UNKNOWN_GLYPH[TASKBAR_GLYPH_H] = {0x1F, 0x11, 0x01, 0x06, 0x04, 0x00, 0x04};
 
-static int taskbar_bar_height(void) {
+int taskbar_bar_height(void) {
 	int h = TASKBAR_HEIGHT;
 	if (h < TASKBAR_BUTTON_H + 4) {
 		h = TASKBAR_BUTTON_H + 4;
@@ -115,6 +115,11 @@ static const uint8_t *glyph_rows_for_char(char ch) {
 	return UNKNOWN_GLYPH;
 }
 
+/* 5x7 bitmap rows for ch, low five bits used, MSB on the left. */
+const uint8_t *taskbar_glyph_rows(char ch) {
+	return glyph_rows_for_char(ch);
+}
+
 static void draw_scaled_run(struct wlr_scene_tree *parent,
 		int x, int y, int width_px, int scale, const float color[4]) {
 	if (width_px <= 0 || scale <= 0) {
@@ -200,6 +205,24 @@ static int text_pixel_width(const char *text, int nchars) {
 	return nchars * TASKBAR_TEXT_ADV - TASKBAR_TEXT_SCALE;
 }
 
+/* Draw text with the taskbar font; returns the width drawn. */
+int taskbar_draw_text(struct wlr_scene_tree *parent, int x, int y,
+		const char *text, const float color[4]) {
+	int len = (int)strlen(text);
+	for (int i = 0; i < len; i++) {
+		draw_glyph(parent, x + i * TASKBAR_TEXT_ADV, y, text[i], TASKBAR_TEXT_SCALE, color);
+	}
+	return text_pixel_width(text, len);
+}
+
+int taskbar_text_width(const char *text) {
+	return text_pixel_width(text, (int)strlen(text));
+}
+
+int taskbar_text_height(void) {
+	return TASKBAR_TEXT_HEIGHT;
+}
+
 static int taskbar_button_width_for_title(const char *title) {
 	int title_px = text_pixel_width(title, (int)strlen(title));
 	int button_w = title_px + TASKBAR_TEXT_PAD_X * 2;
@@ -265,48 +288,159 @@ static void draw_button_label(struct wlr_scene_tree *button_tree,
 	}
 }
 
-static void clear_taskbar_view_state(struct flux_server *server) {
+/* Minimized views are listed on the output their window was on. */
+static struct flux_output *taskbar_output_for_view(struct flux_server *server,
+		const struct flux_view *view) {
+	if (view->fullscreen_output) {
+		return view->fullscreen_output;
+	}
+	struct wlr_output *wlr_output = wlr_output_layout_output_at(server->output_layout,
+		view->x + view->width / 2.0, view->y + view->height / 2.0);
+
+	struct flux_output *fallback = NULL;
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (!output->taskbar_tree) {
+			continue;
+		}
+		if (output->wlr_output == wlr_output) {
+			return output;
+		}
+		if (!fallback) {
+			fallback = output;
+		}
+	}
+	return fallback;
+}
+
+static bool taskbar_output_box(struct flux_output *output, struct wlr_box *box) {
+	wlr_output_layout_get_box(output->server->output_layout, output->wlr_output, box);
+	return box->width > 0 && box->height > 0;
+}
+
+static int taskbar_button_height(int bar_h) {
+	int button_h = TASKBAR_BUTTON_H;
+	if (button_h > bar_h - 4) {
+		button_h = bar_h - 4;
+	}
+	if (button_h < 10) {
+		button_h = bar_h;
+	}
+	return button_h;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t len) {
+	const uint8_t *bytes = data;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+/*
+ * Everything a bar's pixels depend on. A bar is rebuilt only when this
+ * changes, so a title change on one output leaves the others undamaged.
+ */
+static uint64_t taskbar_signature(struct flux_output *output) {
+	struct flux_server *server = output->server;
+	uint64_t hash = 0xcbf29ce484222325ull;
+	struct wlr_box box = {0};
+	taskbar_output_box(output, &box);
+	hash = hash_bytes(hash, &box, sizeof(box));
+	bool covered = output->fullscreen_view != NULL;
+	hash = hash_bytes(hash, &covered, sizeof(covered));
+
 	struct flux_view *view;
 	wl_list_for_each(view, &server->views, link) {
+		if (!view->mapped || !view->minimized ||
+				taskbar_output_for_view(server, view) != output) {
+			continue;
+		}
+		const char *title = view_display_title(view);
+		bool pressed = server->pressed_taskbar_view == view;
+		hash = hash_bytes(hash, &view, sizeof(view));
+		hash = hash_bytes(hash, title, strlen(title) + 1);
+		hash = hash_bytes(hash, &pressed, sizeof(pressed));
+	}
+	return hash;
+}
+
+static void clear_taskbar_view_state(struct flux_output *output, const struct wlr_box *box) {
+	struct flux_view *view;
+	wl_list_for_each(view, &output->server->views, link) {
+		if (!view->taskbar_visible || !wlr_box_contains_point(box,
+				view->taskbar_x, view->taskbar_y)) {
+			continue;
+		}
 		view->taskbar_visible = false;
 		view->taskbar_x = 0;
 		view->taskbar_y = 0;
 		view->taskbar_width = 0;
 		view->taskbar_height = 0;
+		view_index_update(view);
 	}
 }
 
-void taskbar_init(struct flux_server *server) {
-	server->taskbar_tree = wlr_scene_tree_create(&server->scene->tree);
-	server->taskbar_bg_rect =
-		wlr_scene_rect_create(server->taskbar_tree, 1, 1, COLOR_TASKBAR_BG);
-	server->taskbar_buttons_tree = wlr_scene_tree_create(server->taskbar_tree);
-	server->taskbar_layout_x = 0;
-	server->taskbar_layout_y = 0;
-	server->taskbar_layout_width = -1;
-	server->taskbar_layout_height = -1;
-	server->taskbar_dirty = true;
-	wlr_scene_node_set_enabled(&server->taskbar_tree->node, false);
+void taskbar_output_init(struct flux_output *output) {
+	output->taskbar_tree = wlr_scene_tree_create(&output->server->scene->tree);
+	output->taskbar_bg_rect =
+		wlr_scene_rect_create(output->taskbar_tree, 1, 1, COLOR_TASKBAR_BG);
+	output->taskbar_buttons_tree = wlr_scene_tree_create(output->taskbar_tree);
+	output->taskbar_signature = 0;
+	output->taskbar_dirty = true;
+	wlr_scene_node_set_enabled(&output->taskbar_tree->node, false);
+}
+
+void taskbar_output_destroy(struct flux_output *output) {
+	if (!output->taskbar_tree) {
+		return;
+	}
+	clear_taskbar_view_state(output, &output->taskbar_box);
+	wlr_scene_node_destroy(&output->taskbar_tree->node);
+	output->taskbar_tree = NULL;
+	output->taskbar_bg_rect = NULL;
+	output->taskbar_buttons_tree = NULL;
 }
 
 void taskbar_mark_dirty(struct flux_server *server) {
-	server->taskbar_dirty = true;
 	struct flux_output *output;
 	wl_list_for_each(output, &server->outputs, link) {
-		wlr_output_schedule_frame(output->wlr_output);
+		if (!output->taskbar_tree) {
+			continue;
+		}
+		if (taskbar_signature(output) != output->taskbar_signature) {
+			output->taskbar_dirty = true;
+			wlr_output_schedule_frame(output->wlr_output);
+		}
 	}
 }
 
+static bool taskbar_button_contains(const struct flux_view *view, double lx, double ly) {
+	return view->taskbar_visible && view->mapped && view->minimized &&
+		lx >= view->taskbar_x &&
+		ly >= view->taskbar_y &&
+		lx < view->taskbar_x + view->taskbar_width &&
+		ly < view->taskbar_y + view->taskbar_height;
+}
+
 struct flux_view *taskbar_view_at(struct flux_server *server, double lx, double ly) {
+	/* Buttons never overlap, so any candidate that contains the point wins. */
+	struct flux_view *const *candidates = NULL;
+	size_t count = 0;
+	if (server->spatial_index && spatial_index_query(server->spatial_index,
+			FLUX_SPATIAL_TASKBAR, lx, ly, &candidates, &count)) {
+		for (size_t i = 0; i < count; i++) {
+			if (taskbar_button_contains(candidates[i], lx, ly)) {
+				return candidates[i];
+			}
+		}
+		return NULL;
+	}
+
 	struct flux_view *view;
 	wl_list_for_each(view, &server->views, link) {
-		if (!view->taskbar_visible || !view->mapped || !view->minimized) {
-			continue;
-		}
-		if (lx >= view->taskbar_x &&
-				ly >= view->taskbar_y &&
-				lx < view->taskbar_x + view->taskbar_width &&
-				ly < view->taskbar_y + view->taskbar_height) {
+		if (taskbar_button_contains(view, lx, ly)) {
 			return view;
 		}
 	}
@@ -319,21 +453,14 @@ bool taskbar_predict_button_box(struct flux_server *server, struct flux_view *ta
 		return false;
 	}
 
+	struct flux_output *output = taskbar_output_for_view(server, target);
 	struct wlr_box box = {0};
-	wlr_output_layout_get_box(server->output_layout, NULL, &box);
-	if (box.width <= 0 || box.height <= 0) {
+	if (!output || !taskbar_output_box(output, &box)) {
 		return false;
 	}
 
 	int bar_h = taskbar_bar_height();
-	int button_h = TASKBAR_BUTTON_H;
-	if (button_h > bar_h - 4) {
-		button_h = bar_h - 4;
-	}
-	if (button_h < 10) {
-		button_h = bar_h;
-	}
-
+	int button_h = taskbar_button_height(bar_h);
 	int button_y = (bar_h - button_h) / 2;
 	int bar_y = box.y + box.height - bar_h;
 	int cursor_x = TASKBAR_MARGIN;
@@ -342,7 +469,7 @@ bool taskbar_predict_button_box(struct flux_server *server, struct flux_view *ta
 	wl_list_for_each(view, &server->views, link) {
 		bool in_taskbar = view->mapped && (view->minimized ||
 			(include_target_if_not_minimized && view == target && !view->minimized));
-		if (!in_taskbar) {
+		if (!in_taskbar || taskbar_output_for_view(server, view) != output) {
 			continue;
 		}
 
@@ -373,63 +500,60 @@ bool taskbar_predict_button_box(struct flux_server *server, struct flux_view *ta
 	return false;
 }
 
-void taskbar_update(struct flux_server *server) {
-	if (!server->taskbar_tree || !server->taskbar_bg_rect) {
+void taskbar_update_output(struct flux_output *output) {
+	struct flux_server *server = output->server;
+	if (!output->taskbar_tree || !output->taskbar_bg_rect || !output->taskbar_dirty) {
 		return;
 	}
-
-	struct wlr_box box = {0};
-	wlr_output_layout_get_box(server->output_layout, NULL, &box);
-	if (box.width <= 0 || box.height <= 0) {
-		clear_taskbar_view_state(server);
-		wlr_scene_node_set_enabled(&server->taskbar_tree->node, false);
+	output->taskbar_dirty = false;
+	uint64_t signature = taskbar_signature(output);
+	if (signature == output->taskbar_signature) {
 		return;
 	}
+	output->taskbar_signature = signature;
+	output->taskbar_rebuilds++;
 
-	int bar_h = taskbar_bar_height();
-	bool layout_changed = box.x != server->taskbar_layout_x ||
-		box.y != server->taskbar_layout_y ||
-		box.width != server->taskbar_layout_width ||
-		box.height != server->taskbar_layout_height;
-	if (layout_changed) {
-		server->taskbar_layout_x = box.x;
-		server->taskbar_layout_y = box.y;
-		server->taskbar_layout_width = box.width;
-		server->taskbar_layout_height = box.height;
-		server->taskbar_dirty = true;
-	}
-
-	if (!server->taskbar_dirty) {
-		return;
+	clear_taskbar_view_state(output, &output->taskbar_box);
+	if (output->taskbar_buttons_tree) {
+		wlr_scene_node_destroy(&output->taskbar_buttons_tree->node);
 	}
+	output->taskbar_buttons_tree = wlr_scene_tree_create(output->taskbar_tree);
 
-	clear_taskbar_view_state(server);
-	if (server->taskbar_buttons_tree) {
-		wlr_scene_node_destroy(&server->taskbar_buttons_tree->node);
+	struct wlr_box box = {0};
+	if (!taskbar_output_box(output, &box)) {
+		output->taskbar_box = (struct wlr_box){0};
+		wlr_scene_node_set_enabled(&output->taskbar_tree->node, false);
+		return;
 	}
-	server->taskbar_buttons_tree = wlr_scene_tree_create(server->taskbar_tree);
 
+	/* Each bar sits at the bottom of its own output, whatever the others' heights. */
+	int bar_h = taskbar_bar_height();
 	int bar_y = box.y + box.height - bar_h;
-	wlr_scene_node_set_position(&server->taskbar_tree->node, box.x, bar_y);
+	output->taskbar_box = (struct wlr_box){
+		.x = box.x,
+		.y = bar_y,
+		.width = box.width,
+		.height = bar_h,
+	};
+	if (output->fullscreen_view) {
+		wlr_scene_node_set_enabled(&output->taskbar_tree->node, false);
+		return;
+	}
+	wlr_scene_node_set_position(&output->taskbar_tree->node, box.x, bar_y);
 
-	wlr_scene_rect_set_size(server->taskbar_bg_rect, box.width, bar_h);
-	wlr_scene_rect_set_color(server->taskbar_bg_rect, COLOR_WIN98_TASKBAR_BG);
-	wlr_scene_node_set_enabled(&server->taskbar_bg_rect->node, true);
+	wlr_scene_rect_set_size(output->taskbar_bg_rect, box.width, bar_h);
+	wlr_scene_rect_set_color(output->taskbar_bg_rect, COLOR_WIN98_TASKBAR_BG);
+	wlr_scene_node_set_enabled(&output->taskbar_bg_rect->node, true);
 
-	int button_h = TASKBAR_BUTTON_H;
-	if (button_h > bar_h - 4) {
-		button_h = bar_h - 4;
-	}
-	if (button_h < 10) {
-		button_h = bar_h;
-	}
+	int button_h = taskbar_button_height(bar_h);
 	int button_y = (bar_h - button_h) / 2;
 	int cursor_x = TASKBAR_MARGIN;
 	int shown = 0;
 
 	struct flux_view *view;
 	wl_list_for_each(view, &server->views, link) {
-		if (!view->mapped || !view->minimized) {
+		if (!view->mapped || !view->minimized ||
+				taskbar_output_for_view(server, view) != output) {
 			continue;
 		}
 
@@ -444,7 +568,7 @@ void taskbar_update(struct flux_server *server) {
 			button_w = remaining;
 		}
 
-		struct wlr_scene_tree *button_tree = wlr_scene_tree_create(server->taskbar_buttons_tree);
+		struct wlr_scene_tree *button_tree = wlr_scene_tree_create(output->taskbar_buttons_tree);
 		wlr_scene_node_set_position(&button_tree->node, cursor_x, button_y);
 
 		bool pressed = server->pressed_taskbar_view == view;
@@ -456,17 +580,17 @@ void taskbar_update(struct flux_server *server) {
 		view->taskbar_y = bar_y + button_y;
 		view->taskbar_width = button_w;
 		view->taskbar_height = button_h;
+		view_index_update(view);
 
 		cursor_x += button_w + TASKBAR_MARGIN;
 		shown++;
 	}
 
-	wlr_scene_node_set_enabled(&server->taskbar_tree->node, shown > 0);
+	wlr_scene_node_set_enabled(&output->taskbar_tree->node, shown > 0);
 	if (shown > 0) {
-		wlr_scene_node_raise_to_top(&server->taskbar_tree->node);
+		wlr_scene_node_raise_to_top(&output->taskbar_tree->node);
 		if (server->cursor_tree) {
 			wlr_scene_node_raise_to_top(&server->cursor_tree->node);
 		}
 	}
-	server->taskbar_dirty = false;
 }
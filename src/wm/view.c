@@ -3,13 +3,19 @@
 #define MINIMIZE_ANIMATION_DURATION_MS 180
 #define RESTORE_ANIMATION_DURATION_MS 180
 #define MINIMIZE_ANIMATION_MIN_SCALE 0.12f
+#define ACTIVE_RENDER_COMMIT_GAP_MS 100
+#define ACTIVE_RENDER_MIN_COMMITS 8
+
+static bool view_draws_decorations(const struct flux_view *view) {
+	return view->use_server_decorations && !view->fullscreen;
+}
 
 static int view_border_px(const struct flux_view *view) {
-	return view->use_server_decorations ? BORDER_PX : 0;
+	return view_draws_decorations(view) ? BORDER_PX : 0;
 }
 
 static int view_titlebar_px(const struct flux_view *view) {
-	return view->use_server_decorations ? TITLEBAR_PX : 0;
+	return view_draws_decorations(view) ? TITLEBAR_PX : 0;
 }
 
 static bool view_app_id_contains(const struct flux_view *view, const char *needle) {
@@ -97,12 +103,6 @@ static void raise_cursor_to_top(struct flux_server *server) {
 	}
 }
 
-static void schedule_all_output_frames(struct flux_server *server) {
-	struct flux_output *output;
-	wl_list_for_each(output, &server->outputs, link) {
-		wlr_output_schedule_frame(output->wlr_output);
-	}
-}
 
 static void view_get_geometry_box(struct flux_view *view, struct wlr_box *geo) {
 	int surface_w = view->xdg_surface->surface->current.width;
@@ -194,6 +194,7 @@ void place_new_view(struct flux_server *server, struct flux_view *view) {
 		server->next_view_x = base_x;
 		server->next_view_y = base_y;
 	}
+	view_index_update(view);
 }
 
 void configure_new_toplevel(struct flux_server *server, struct wlr_xdg_surface *xdg_surface) {
@@ -248,15 +249,21 @@ void view_set_frame_size(struct flux_view *view, int frame_width, int frame_heig
 		view->use_server_decorations ? BTN_W : 1,
 		view->use_server_decorations ? BTN_H : 1);
 	wlr_scene_node_set_position(&view->minimize_rect->node, btn_x, btn_y);
+	view_index_update(view);
 }
 
-void view_set_server_decorations(struct flux_view *view, bool enabled) {
-	view->use_server_decorations = enabled;
+static void view_update_decoration_nodes(struct flux_view *view) {
+	bool enabled = view_draws_decorations(view);
 	wlr_scene_node_set_enabled(&view->title_rect->node, enabled);
 	wlr_scene_node_set_enabled(&view->left_border_rect->node, enabled);
 	wlr_scene_node_set_enabled(&view->right_border_rect->node, enabled);
 	wlr_scene_node_set_enabled(&view->bottom_border_rect->node, enabled);
 	wlr_scene_node_set_enabled(&view->minimize_rect->node, enabled);
+}
+
+void view_set_server_decorations(struct flux_view *view, bool enabled) {
+	view->use_server_decorations = enabled;
+	view_update_decoration_nodes(view);
 	view_update_geometry(view);
 }
 
@@ -367,6 +374,22 @@ static void taskbar_target_for_animation(struct flux_view *view,
 	*scale = MINIMIZE_ANIMATION_MIN_SCALE;
 }
 
+/*
+ * Under the low-power profile windows slide at full size and opacity to just
+ * below the layout, lined up with their taskbar button. Moving a node only
+ * damages the two positions; scaling or fading would re-composite the window
+ * through the software renderer's slow paths every frame.
+ */
+static bool low_power_animations(struct flux_server *server) {
+	return server->render_profile == FLUX_RENDER_PROFILE_LOW_POWER;
+}
+
+static double low_power_offscreen_cy(struct flux_view *view) {
+	struct wlr_box layout;
+	get_layout_box_or_default(view->server, &layout);
+	return layout.y + layout.height + view->height / 2.0;
+}
+
 static void apply_window_transform(struct flux_view *view,
 		double center_x, double center_y, float scale, float alpha) {
 	scale = clampf(scale, MINIMIZE_ANIMATION_MIN_SCALE, 1.0f);
@@ -384,6 +407,12 @@ static void apply_window_transform(struct flux_view *view,
 	int frame_x = (int)lround(center_x - scaled_w / 2.0);
 	int frame_y = (int)lround(center_y - scaled_h / 2.0);
 	wlr_scene_node_set_position(&view->frame_tree->node, frame_x, frame_y);
+	view->anim_current_box = (struct wlr_box){
+		.x = frame_x,
+		.y = frame_y,
+		.width = scaled_w,
+		.height = scaled_h,
+	};
 
 	int border = (int)lroundf((float)BORDER_PX * scale);
 	int title_h = (int)lroundf((float)TITLEBAR_PX * scale);
@@ -447,6 +476,12 @@ static void apply_window_transform(struct flux_view *view,
 	set_rect_alpha(view->bottom_border_rect, COLOR_BORDER, alpha);
 	set_rect_alpha(view->minimize_rect, COLOR_MIN_BUTTON, alpha);
 
+	if (scale >= 1.0f && alpha >= 1.0f) {
+		/* Pure translation: leave client buffers at their natural size. */
+		wlr_scene_node_for_each_buffer(&view->content_tree->node,
+			reset_content_transform_cb, NULL);
+		return;
+	}
 	struct content_transform_state state = {
 		.scale = scale,
 		.opacity = alpha,
@@ -477,16 +512,119 @@ static void reset_window_animation_state(struct flux_view *view) {
 	wlr_scene_node_for_each_buffer(&view->content_tree->node, reset_content_transform_cb, NULL);
 }
 
+static struct flux_output *output_for_fullscreen(struct flux_view *view,
+		struct wlr_output *requested) {
+	struct flux_server *server = view->server;
+	struct wlr_output *wlr_output = requested;
+	if (!wlr_output) {
+		wlr_output = wlr_output_layout_output_at(server->output_layout,
+			view->x + view->width / 2.0, view->y + view->height / 2.0);
+	}
+
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output->wlr_output == wlr_output && output_is_mirror(output)) {
+			/* Mirrors have no layout space; use the output under the view. */
+			return output_for_fullscreen(view, NULL);
+		}
+		if (!output_is_mirror(output) &&
+				(!wlr_output || output->wlr_output == wlr_output)) {
+			return output;
+		}
+	}
+	return NULL;
+}
+
+void view_set_fullscreen(struct flux_view *view, bool fullscreen,
+		struct wlr_output *requested) {
+	if (!view || !view->xdg_surface->toplevel) {
+		return;
+	}
+	struct flux_server *server = view->server;
+
+	struct flux_output *output = NULL;
+	if (fullscreen) {
+		output = output_for_fullscreen(view, requested);
+		if (!output) {
+			wlr_log(WLR_INFO, "fullscreen request ignored: no output");
+			fullscreen = false;
+		}
+	}
+	/* Re-entering on the same output refits the view, e.g. after a mode change. */
+	bool refit = fullscreen && view->fullscreen && view->fullscreen_output == output;
+
+	if (view->fullscreen && !refit) {
+		struct flux_output *prev = view->fullscreen_output;
+		if (prev && prev->fullscreen_view == view) {
+			prev->fullscreen_view = NULL;
+			output_set_background_enabled(prev, true);
+		}
+		view->fullscreen = false;
+		view->fullscreen_output = NULL;
+		if (!fullscreen) {
+			view->x = view->saved_x;
+			view->y = view->saved_y;
+			wlr_xdg_toplevel_set_size(view->xdg_surface->toplevel,
+				view->saved_width, view->saved_height);
+		}
+	} else if (fullscreen && !view->fullscreen) {
+		view->saved_x = view->x;
+		view->saved_y = view->y;
+		view->saved_width = view->xdg_geo_width;
+		view->saved_height = view->xdg_geo_height;
+	}
+
+	if (fullscreen) {
+		if (output->fullscreen_view && output->fullscreen_view != view) {
+			view_set_fullscreen(output->fullscreen_view, false, NULL);
+		}
+
+		struct wlr_box box = {0};
+		wlr_output_layout_get_box(server->output_layout, output->wlr_output, &box);
+		view->fullscreen = true;
+		view->fullscreen_output = output;
+		output->fullscreen_view = view;
+		view->x = box.x;
+		view->y = box.y;
+		wlr_xdg_toplevel_set_size(view->xdg_surface->toplevel, box.width, box.height);
+
+		/*
+		 * The scene can only scan a client buffer out when nothing else is
+		 * visible on the output, so drop the background and keep the view on top.
+		 * Hit-tests follow server->views, so restack it there as well.
+		 */
+		output_set_background_enabled(output, false);
+		wl_list_remove(&view->link);
+		wl_list_insert(&server->views, &view->link);
+		view_raise_stack(view);
+		wlr_scene_node_raise_to_top(&view->frame_tree->node);
+		raise_cursor_to_top(server);
+	}
+
+	wlr_xdg_toplevel_set_fullscreen(view->xdg_surface->toplevel, view->fullscreen);
+	view_update_decoration_nodes(view);
+	view_update_geometry(view);
+	wlr_scene_node_set_position(&view->frame_tree->node, view->x, view->y);
+	wlr_log(WLR_INFO, "view %s fullscreen on %s",
+		view->fullscreen ? "entered" : "left",
+		view->fullscreen ? view->fullscreen_output->wlr_output->name : "-");
+	taskbar_mark_dirty(server);
+}
+
 void view_begin_minimize_animation(struct flux_view *view, uint32_t time_msec) {
 	if (!view || !view->mapped || view->minimized ||
 			view->minimizing_animation || view->restoring_animation) {
 		return;
 	}
+	if (view->fullscreen) {
+		view_set_fullscreen(view, false, NULL);
+	}
 
 	view->minimizing_animation = true;
 	view->minimize_animation_start_msec = time_msec;
 	view->restoring_animation = false;
 	view->restore_animation_start_msec = 0;
+	view_index_update(view);
 
 	if (view->xdg_surface && view->xdg_surface->toplevel) {
 		wlr_xdg_toplevel_set_activated(view->xdg_surface->toplevel, false);
@@ -511,10 +649,16 @@ void view_begin_minimize_animation(struct flux_view *view, uint32_t time_msec) {
 	view->anim_to_scale = to_scale;
 	view->anim_from_alpha = 1.0f;
 	view->anim_to_alpha = 0.35f;
+	if (low_power_animations(server)) {
+		view->anim_to_cy = low_power_offscreen_cy(view);
+		view->anim_to_scale = 1.0f;
+		view->anim_to_alpha = 1.0f;
+	}
 
 	apply_running_animation_state(view, 0.0f);
 
-	schedule_all_output_frames(server);
+	server->animations_running = true;
+	view_schedule_animation_frames(server, NULL);
 }
 
 void view_begin_restore_animation(struct flux_view *view, uint32_t time_msec) {
@@ -553,6 +697,7 @@ void view_begin_restore_animation(struct flux_view *view, uint32_t time_msec) {
 	view->restore_animation_start_msec = time_msec;
 	view->minimizing_animation = false;
 	view->minimize_animation_start_msec = 0;
+	view_index_update(view);
 
 	view->anim_from_cx = from_cx;
 	view->anim_from_cy = from_cy;
@@ -562,11 +707,17 @@ void view_begin_restore_animation(struct flux_view *view, uint32_t time_msec) {
 	view->anim_to_scale = 1.0f;
 	view->anim_from_alpha = 0.35f;
 	view->anim_to_alpha = 1.0f;
+	if (low_power_animations(server)) {
+		view->anim_from_cy = low_power_offscreen_cy(view);
+		view->anim_from_scale = 1.0f;
+		view->anim_from_alpha = 1.0f;
+	}
 
 	view_set_visible(view, true);
 	apply_running_animation_state(view, 0.0f);
 	taskbar_mark_dirty(server);
-	schedule_all_output_frames(server);
+	server->animations_running = true;
+	view_schedule_animation_frames(server, NULL);
 }
 
 bool view_tick_animations(struct flux_server *server, uint32_t time_msec) {
@@ -585,6 +736,7 @@ bool view_tick_animations(struct flux_server *server, uint32_t time_msec) {
 				view->minimizing_animation = false;
 				reset_window_animation_state(view);
 				view->minimized = true;
+				view_index_update(view);
 				view_set_visible(view, false);
 				taskbar_mark_dirty(server);
 				continue;
@@ -601,6 +753,7 @@ bool view_tick_animations(struct flux_server *server, uint32_t time_msec) {
 			if (progress >= 1.0f) {
 				view->restoring_animation = false;
 				reset_window_animation_state(view);
+				view_index_update(view);
 				focus_view(view, view->xdg_surface->surface);
 				continue;
 			}
@@ -613,6 +766,108 @@ bool view_tick_animations(struct flux_server *server, uint32_t time_msec) {
 	return any_running;
 }
 
+static void animation_endpoint_box(const struct flux_view *view,
+		double center_x, double center_y, float scale, struct wlr_box *out) {
+	scale = clampf(scale, MINIMIZE_ANIMATION_MIN_SCALE, 1.0f);
+	out->width = (int)lroundf((float)view->width * scale) + 1;
+	out->height = (int)lroundf((float)view->height * scale) + 1;
+	out->x = (int)floor(center_x - out->width / 2.0);
+	out->y = (int)floor(center_y - out->height / 2.0);
+}
+
+static void box_union(struct wlr_box *acc, const struct wlr_box *box) {
+	if (box->width <= 0 || box->height <= 0) {
+		return;
+	}
+	if (acc->width <= 0 || acc->height <= 0) {
+		*acc = *box;
+		return;
+	}
+	int x1 = acc->x < box->x ? acc->x : box->x;
+	int y1 = acc->y < box->y ? acc->y : box->y;
+	int x2 = acc->x + acc->width > box->x + box->width ?
+		acc->x + acc->width : box->x + box->width;
+	int y2 = acc->y + acc->height > box->y + box->height ?
+		acc->y + acc->height : box->y + box->height;
+	*acc = (struct wlr_box){ .x = x1, .y = y1, .width = x2 - x1, .height = y2 - y1 };
+}
+
+static bool animation_touches_output(struct flux_server *server,
+		struct flux_output *output, const struct wlr_box *bounds) {
+	return bounds->width > 0 && bounds->height > 0 &&
+		wlr_output_layout_intersects(server->output_layout, output->wlr_output, bounds);
+}
+
+/*
+ * Wake only outputs that an animation can draw on: the union of every
+ * running animation's start, end and current boxes. Every touched output
+ * calls this after its repaint; only the lead one (the first output woken)
+ * counts the frames saved elsewhere, so each animation tick counts once.
+ */
+void view_schedule_animation_frames(struct flux_server *server,
+		struct flux_output *repainted) {
+	struct wlr_box bounds = {0};
+	struct flux_view *view;
+	wl_list_for_each(view, &server->views, link) {
+		if (!view->mapped || (!view->minimizing_animation && !view->restoring_animation)) {
+			continue;
+		}
+		struct wlr_box box;
+		animation_endpoint_box(view, view->anim_from_cx, view->anim_from_cy,
+			view->anim_from_scale, &box);
+		box_union(&bounds, &box);
+		animation_endpoint_box(view, view->anim_to_cx, view->anim_to_cy,
+			view->anim_to_scale, &box);
+		box_union(&bounds, &box);
+		box_union(&bounds, &view->anim_current_box);
+	}
+
+	/* Animations are ticked from frame events, so keep at least one coming. */
+	bool any_touched = false;
+	struct flux_output *output;
+	wl_list_for_each(output, &server->outputs, link) {
+		any_touched = any_touched || animation_touches_output(server, output, &bounds);
+	}
+
+	struct flux_output *lead = NULL;
+	wl_list_for_each(output, &server->outputs, link) {
+		if (animation_touches_output(server, output, &bounds) ||
+				(!any_touched && !lead)) {
+			wlr_output_schedule_frame(output->wlr_output);
+			lead = lead ? lead : output;
+		}
+	}
+	if (!lead || repainted != lead) {
+		return;
+	}
+	wl_list_for_each(output, &server->outputs, link) {
+		if (output != lead && !animation_touches_output(server, output, &bounds)) {
+			output->animation_frames_saved++;
+		}
+	}
+}
+
+void view_note_commit(struct flux_view *view, uint32_t time_msec) {
+	if (view->last_commit_msec != 0 &&
+			time_msec - view->last_commit_msec <= ACTIVE_RENDER_COMMIT_GAP_MS) {
+		if (view->rapid_commit_count < UINT32_MAX) {
+			view->rapid_commit_count++;
+		}
+	} else {
+		view->rapid_commit_count = 0;
+	}
+	view->last_commit_msec = time_msec;
+}
+
+bool view_is_actively_rendering(struct flux_view *view, uint32_t time_msec) {
+	if (!view || !view->mapped || view->minimized) {
+		return false;
+	}
+	/* A steady stream of commits means the client is animating or playing video. */
+	return view->rapid_commit_count >= ACTIVE_RENDER_MIN_COMMITS &&
+		time_msec - view->last_commit_msec <= ACTIVE_RENDER_COMMIT_GAP_MS;
+}
+
 void focus_view(struct flux_view *view, struct wlr_surface *surface) {
 	if (!view || view->minimized || view->minimizing_animation ||
 			view->restoring_animation || !view->mapped) {
@@ -643,6 +898,7 @@ void focus_view(struct flux_view *view, struct wlr_surface *surface) {
 
 	wl_list_remove(&view->link);
 	wl_list_insert(&server->views, &view->link);
+	view_raise_stack(view);
 	wlr_scene_node_raise_to_top(&view->frame_tree->node);
 	raise_cursor_to_top(server);
 	if (view->xdg_surface && view->xdg_surface->toplevel) {
@@ -656,63 +912,143 @@ void focus_view(struct flux_view *view, struct wlr_surface *surface) {
 	}
 }
 
-struct flux_view *view_at(struct flux_server *server, double lx, double ly,
-		struct wlr_surface **surface, double *sx, double *sy) {
-	struct flux_view *view;
-	wl_list_for_each(view, &server->views, link) {
-		if (!view->mapped || view->minimized ||
-				view->minimizing_animation || view->restoring_animation) {
-			continue;
-		}
+/* Callers move the view to the head of server->views. */
+void view_raise_stack(struct flux_view *view) {
+	view->stack_seq = ++view->server->view_stack_seq;
+	if (view->server->spatial_index) {
+		spatial_index_restack(view->server->spatial_index, view);
+	}
+}
 
-		if (lx < view->x || ly < view->y ||
-			lx >= view->x + view->width || ly >= view->y + view->height) {
-			continue;
-		}
+static bool view_accepts_pointer(const struct flux_view *view) {
+	return view->mapped && !view->minimized &&
+		!view->minimizing_animation && !view->restoring_animation;
+}
 
-		double local_x = lx - (view->x + view->content_x);
-		double local_y = ly - (view->y + view->content_y);
-		struct wlr_surface *hit = wlr_xdg_surface_surface_at(view->xdg_surface,
-			local_x, local_y, sx, sy);
-		if (hit) {
-			*surface = hit;
-			return view;
-		}
+static bool view_frame_contains(const struct flux_view *view, double lx, double ly, int pad) {
+	return lx >= view->x - pad && ly >= view->y - pad &&
+		lx < view->x + view->width + pad && ly < view->y + view->height + pad;
+}
 
-		if (!view->use_server_decorations) {
-			*surface = NULL;
-			return NULL;
-		}
+/*
+ * Keep the spatial index in step with everything the hit-tests below look at:
+ * geometry, grab padding, minimize/animation state and taskbar buttons.
+ */
+void view_index_update(struct flux_view *view) {
+	struct flux_spatial_index *index = view->server->spatial_index;
+	if (!index) {
+		return;
+	}
 
-		*surface = NULL;
-		*sx = local_x;
-		*sy = local_y;
-		return view;
+	struct wlr_box frame = {0};
+	if (view_accepts_pointer(view)) {
+		int pad = view_outer_grab_pad(view);
+		frame = (struct wlr_box){
+			.x = view->x - pad,
+			.y = view->y - pad,
+			.width = view->width + pad * 2,
+			.height = view->height + pad * 2,
+		};
 	}
+	spatial_index_set(index, FLUX_SPATIAL_FRAMES, view, &frame);
 
-	*surface = NULL;
-	return NULL;
+	struct wlr_box button = {0};
+	if (view->taskbar_visible && view->mapped && view->minimized) {
+		button = (struct wlr_box){
+			.x = view->taskbar_x,
+			.y = view->taskbar_y,
+			.width = view->taskbar_width,
+			.height = view->taskbar_height,
+		};
+	}
+	spatial_index_set(index, FLUX_SPATIAL_TASKBAR, view, &button);
 }
 
-struct flux_view *view_frame_at(struct flux_server *server, double lx, double ly) {
+void view_index_remove(struct flux_view *view) {
+	struct flux_spatial_index *index = view->server->spatial_index;
+	if (!index) {
+		return;
+	}
+	for (int layer = 0; layer < FLUX_SPATIAL_LAYERS; layer++) {
+		spatial_index_set(index, (enum flux_spatial_layer)layer, view, NULL);
+	}
+}
+
+/* The grid covers the output layout, so it is rebuilt whenever that changes. */
+void view_index_rebuild(struct flux_server *server) {
+	if (!server->spatial_index) {
+		return;
+	}
+	struct wlr_box box = {0};
+	wlr_output_layout_get_box(server->output_layout, NULL, &box);
+	spatial_index_reset(server->spatial_index, &box);
+
 	struct flux_view *view;
 	wl_list_for_each(view, &server->views, link) {
-		if (!view->mapped || view->minimized ||
-				view->minimizing_animation || view->restoring_animation) {
-			continue;
+		view_index_update(view);
+	}
+}
+
+/*
+ * Topmost pointer-accepting view whose frame, grown by its grab pad when
+ * asked, contains the point. Only the point's grid cell is examined, in the
+ * same top-down order as server->views; the list walk remains for points the
+ * grid cannot answer.
+ */
+static struct flux_view *topmost_view_at(struct flux_server *server,
+		double lx, double ly, bool grab_pad) {
+	struct flux_view *const *candidates = NULL;
+	size_t count = 0;
+	if (server->spatial_index && spatial_index_query(server->spatial_index,
+			FLUX_SPATIAL_FRAMES, lx, ly, &candidates, &count)) {
+		for (size_t i = 0; i < count; i++) {
+			struct flux_view *view = candidates[i];
+			if (view_accepts_pointer(view) && view_frame_contains(view, lx, ly,
+					grab_pad ? view_outer_grab_pad(view) : 0)) {
+				return view;
+			}
 		}
+		return NULL;
+	}
 
-		int pad = view_outer_grab_pad(view);
-		if (lx < view->x - pad || ly < view->y - pad ||
-				lx >= view->x + view->width + pad ||
-				ly >= view->y + view->height + pad) {
-			continue;
+	struct flux_view *view;
+	wl_list_for_each(view, &server->views, link) {
+		if (view_accepts_pointer(view) && view_frame_contains(view, lx, ly,
+				grab_pad ? view_outer_grab_pad(view) : 0)) {
+			return view;
 		}
+	}
+	return NULL;
+}
+
+struct flux_view *view_at(struct flux_server *server, double lx, double ly,
+		struct wlr_surface **surface, double *sx, double *sy) {
+	*surface = NULL;
+	struct flux_view *view = topmost_view_at(server, lx, ly, false);
+	if (!view) {
+		return NULL;
+	}
 
+	double local_x = lx - (view->x + view->content_x);
+	double local_y = ly - (view->y + view->content_y);
+	struct wlr_surface *hit = wlr_xdg_surface_surface_at(view->xdg_surface,
+		local_x, local_y, sx, sy);
+	if (hit) {
+		*surface = hit;
 		return view;
 	}
 
-	return NULL;
+	if (!view->use_server_decorations) {
+		return NULL;
+	}
+
+	*sx = local_x;
+	*sy = local_y;
+	return view;
+}
+
+struct flux_view *view_frame_at(struct flux_server *server, double lx, double ly) {
+	return topmost_view_at(server, lx, ly, true);
 }
 
 uint32_t view_resize_edges_at(struct flux_view *view, double lx, double ly) {
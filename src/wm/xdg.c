@@ -67,7 +67,7 @@ static bool validate_interactive_request(struct flux_view *view,
 		return false;
 	}
 
-	if (!view->mapped || view->minimized ||
+	if (!view->mapped || view->minimized || view->fullscreen ||
 			view->minimizing_animation || view->restoring_animation) {
 		return false;
 	}
@@ -130,6 +130,24 @@ static void view_request_resize_notify(struct wl_listener *listener, void *data)
 	server->suppress_button_until_release = true;
 }
 
+static void view_request_fullscreen_notify(struct wl_listener *listener, void *data) {
+	(void)data;
+	struct flux_view *view = wl_container_of(listener, view, request_fullscreen);
+	struct wlr_xdg_toplevel *toplevel = view->xdg_surface->toplevel;
+
+	/* Uninitialized toplevels pick the request up from view_map_notify. */
+	if (!xdg_surface_ready(view->xdg_surface)) {
+		return;
+	}
+	if (view->minimized || view->minimizing_animation || view->restoring_animation) {
+		wlr_xdg_surface_schedule_configure(view->xdg_surface);
+		return;
+	}
+
+	view_set_fullscreen(view, toplevel->requested.fullscreen,
+		toplevel->requested.fullscreen_output);
+}
+
 void xdg_activation_request_activate_notify(struct wl_listener *listener, void *data) {
 	struct flux_server *server = wl_container_of(
 		listener, server, xdg_activation_request_activate);
@@ -170,6 +188,7 @@ static void view_map_notify(struct wl_listener *listener, void *data) {
 	(void)data;
 	struct flux_view *view = wl_container_of(listener, view, map);
 	apply_decoration_mode_to_view(view);
+	frame_done_update_opt_out(view);
 	view->mapped = true;
 	view->minimized = false;
 	view->minimizing_animation = false;
@@ -187,7 +206,12 @@ static void view_map_notify(struct wl_listener *listener, void *data) {
 		view->content_x, view->content_y, view->x, view->y, view->width, view->height,
 		view->use_server_decorations ? 1 : 0);
 	view_set_visible(view, true);
+	if (view->xdg_surface->toplevel->requested.fullscreen) {
+		view_set_fullscreen(view, true,
+			view->xdg_surface->toplevel->requested.fullscreen_output);
+	}
 	focus_view(view, view->xdg_surface->surface);
+	capture_view_map(view);
 	taskbar_mark_dirty(view->server);
 }
 
@@ -197,17 +221,98 @@ static void view_unmap_notify(struct wl_listener *listener, void *data) {
 	if (view->server->pressed_taskbar_view == view) {
 		view->server->pressed_taskbar_view = NULL;
 	}
+	if (view->fullscreen) {
+		view_set_fullscreen(view, false, NULL);
+	}
 	view->mapped = false;
 	view->minimizing_animation = false;
 	view->restoring_animation = false;
+	view_index_update(view);
 	wlr_log(WLR_INFO, "view unmap");
+	capture_view_unmap(view);
 	view_set_visible(view, false);
 	taskbar_mark_dirty(view->server);
 }
 
+static void set_filter_mode_cb(struct wlr_scene_buffer *buffer, int sx, int sy, void *data) {
+	(void)sx;
+	(void)sy;
+	enum wlr_scale_filter_mode *mode = data;
+	wlr_scene_buffer_set_filter_mode(buffer, *mode);
+}
+
+static void view_apply_filter_mode(struct flux_view *view) {
+	enum wlr_scale_filter_mode mode = render_profile_scale_filter(view->server);
+	wlr_scene_node_for_each_buffer(&view->content_tree->node, set_filter_mode_cb, &mode);
+}
+
+/*
+ * The low-power profile scales client content with NEAREST. Scene buffers
+ * keep their filter, so each is set once: the view's own at creation, a
+ * subsurface's when it maps. Subsurfaces of subsurfaces are tracked too.
+ */
+struct flux_view_subsurface {
+	struct wl_list link; // flux_view::subsurfaces
+	struct flux_view *view;
+	struct wlr_subsurface *subsurface;
+	struct wl_listener map;
+	struct wl_listener new_subsurface;
+	struct wl_listener destroy;
+};
+
+static void view_subsurface_destroy(struct flux_view_subsurface *tracked) {
+	wl_list_remove(&tracked->link);
+	wl_list_remove(&tracked->map.link);
+	wl_list_remove(&tracked->new_subsurface.link);
+	wl_list_remove(&tracked->destroy.link);
+	free(tracked);
+}
+
+static void view_subsurface_map_notify(struct wl_listener *listener, void *data) {
+	(void)data;
+	struct flux_view_subsurface *tracked = wl_container_of(listener, tracked, map);
+	view_apply_filter_mode(tracked->view);
+}
+
+static void view_subsurface_destroy_notify(struct wl_listener *listener, void *data) {
+	(void)data;
+	struct flux_view_subsurface *tracked = wl_container_of(listener, tracked, destroy);
+	view_subsurface_destroy(tracked);
+}
+
+static void view_track_subsurface(struct flux_view *view, struct wlr_subsurface *subsurface);
+
+static void view_subsurface_new_subsurface_notify(struct wl_listener *listener, void *data) {
+	struct flux_view_subsurface *tracked = wl_container_of(listener, tracked, new_subsurface);
+	view_track_subsurface(tracked->view, data);
+}
+
+static void view_track_subsurface(struct flux_view *view, struct wlr_subsurface *subsurface) {
+	struct flux_view_subsurface *tracked = calloc(1, sizeof(*tracked));
+	if (!tracked) {
+		wlr_log(WLR_ERROR, "view: out of memory tracking a subsurface");
+		return;
+	}
+	tracked->view = view;
+	tracked->subsurface = subsurface;
+	tracked->map.notify = view_subsurface_map_notify;
+	wl_signal_add(&subsurface->surface->events.map, &tracked->map);
+	tracked->new_subsurface.notify = view_subsurface_new_subsurface_notify;
+	wl_signal_add(&subsurface->surface->events.new_subsurface, &tracked->new_subsurface);
+	tracked->destroy.notify = view_subsurface_destroy_notify;
+	wl_signal_add(&subsurface->events.destroy, &tracked->destroy);
+	wl_list_insert(&view->subsurfaces, &tracked->link);
+}
+
+static void view_new_subsurface_notify(struct wl_listener *listener, void *data) {
+	struct flux_view *view = wl_container_of(listener, view, new_subsurface);
+	view_track_subsurface(view, data);
+}
+
 static void view_commit_notify(struct wl_listener *listener, void *data) {
 	(void)data;
 	struct flux_view *view = wl_container_of(listener, view, commit);
+	view->server->client_commits++;
 	if (!view->mapped) {
 		/*
 		 * New xdg-toplevels need an initial configure before they can map.
@@ -223,6 +328,9 @@ static void view_commit_notify(struct wl_listener *listener, void *data) {
 	if (view->minimized || view->minimizing_animation || view->restoring_animation) {
 		return;
 	}
+	uint64_t now_nsec = monotonic_nsec();
+	view_note_commit(view, (uint32_t)(now_nsec / 1000000ull));
+	frame_done_note_commit(view, now_nsec);
 	view_update_geometry(view);
 }
 
@@ -241,7 +349,15 @@ static void view_destroy_notify(struct wl_listener *listener, void *data) {
 	wl_list_remove(&view->set_app_id.link);
 	wl_list_remove(&view->request_move.link);
 	wl_list_remove(&view->request_resize.link);
+	wl_list_remove(&view->request_fullscreen.link);
+	wl_list_remove(&view->new_subsurface.link);
+	struct flux_view_subsurface *tracked, *tmp;
+	wl_list_for_each_safe(tracked, tmp, &view->subsurfaces, link) {
+		view_subsurface_destroy(tracked);
+	}
 	wl_list_remove(&view->link);
+	view_index_remove(view);
+	capture_view_destroy(view);
 	taskbar_mark_dirty(view->server);
 	free(view);
 }
@@ -249,6 +365,7 @@ static void view_destroy_notify(struct wl_listener *listener, void *data) {
 static void view_set_title_notify(struct wl_listener *listener, void *data) {
 	(void)data;
 	struct flux_view *view = wl_container_of(listener, view, set_title);
+	capture_view_update(view);
 	taskbar_mark_dirty(view->server);
 }
 
@@ -256,6 +373,8 @@ static void view_set_app_id_notify(struct wl_listener *listener, void *data) {
 	(void)data;
 	struct flux_view *view = wl_container_of(listener, view, set_app_id);
 	apply_decoration_mode_to_view(view);
+	frame_done_update_opt_out(view);
+	capture_view_update(view);
 	taskbar_mark_dirty(view->server);
 }
 
@@ -314,7 +433,17 @@ void new_xdg_toplevel_notify(struct wl_listener *listener, void *data) {
 	wl_signal_add(&xdg_toplevel->events.request_move, &view->request_move);
 	view->request_resize.notify = view_request_resize_notify;
 	wl_signal_add(&xdg_toplevel->events.request_resize, &view->request_resize);
+	view->request_fullscreen.notify = view_request_fullscreen_notify;
+	wl_signal_add(&xdg_toplevel->events.request_fullscreen, &view->request_fullscreen);
+	wl_list_init(&view->subsurfaces);
+	wl_list_init(&view->new_subsurface.link);
+	if (server->render_profile == FLUX_RENDER_PROFILE_LOW_POWER) {
+		view_apply_filter_mode(view);
+		view->new_subsurface.notify = view_new_subsurface_notify;
+		wl_signal_add(&xdg_surface->surface->events.new_subsurface, &view->new_subsurface);
+	}
 
 	wl_list_insert(&server->views, &view->link);
+	view_raise_stack(view);
 	taskbar_mark_dirty(server);
 }
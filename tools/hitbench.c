@@ -0,0 +1,162 @@
+#include "flux.h"
+
+/*
+ * Pointer hit-test microbenchmark: the list walk view_frame_at() used to do
+ * against the spatial index, on random overlapping windows over a
+ * 3840x2160 layout. Both must agree on every query.
+ *
+ *   hitbench [queries]
+ */
+
+#define LAYOUT_W 3840
+#define LAYOUT_H 2160
+#define GRAB_PAD 4
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ull;
+
+static uint32_t rng_next(void) {
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 7;
+	rng_state ^= rng_state << 17;
+	return (uint32_t)(rng_state >> 32);
+}
+
+static int rng_range(int lo, int hi) {
+	return lo + (int)(rng_next() % (uint32_t)(hi - lo + 1));
+}
+
+static uint64_t now_nsec(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static bool frame_contains(const struct flux_view *view, double lx, double ly) {
+	return view->mapped && !view->minimized &&
+		lx >= view->x - GRAB_PAD && ly >= view->y - GRAB_PAD &&
+		lx < view->x + view->width + GRAB_PAD && ly < view->y + view->height + GRAB_PAD;
+}
+
+/* views[] is in stacking order, topmost first, like server->views. */
+static struct flux_view *linear_at(struct flux_view **views, int count, double lx, double ly) {
+	for (int i = 0; i < count; i++) {
+		if (frame_contains(views[i], lx, ly)) {
+			return views[i];
+		}
+	}
+	return NULL;
+}
+
+static struct flux_view *indexed_at(struct flux_spatial_index *index, double lx, double ly) {
+	struct flux_view *const *candidates = NULL;
+	size_t count = 0;
+	if (!spatial_index_query(index, FLUX_SPATIAL_FRAMES, lx, ly, &candidates, &count)) {
+		return NULL;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (frame_contains(candidates[i], lx, ly)) {
+			return candidates[i];
+		}
+	}
+	return NULL;
+}
+
+static int run(int view_count, int query_count) {
+	struct flux_view *storage = calloc((size_t)view_count, sizeof(*storage));
+	struct flux_view **views = calloc((size_t)view_count, sizeof(*views));
+	double *points = calloc((size_t)query_count * 2, sizeof(*points));
+	struct flux_spatial_index *index = spatial_index_create();
+	if (!storage || !views || !points || !index) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	struct wlr_box bounds = {.width = LAYOUT_W, .height = LAYOUT_H};
+	spatial_index_reset(index, &bounds);
+	for (int i = 0; i < view_count; i++) {
+		struct flux_view *view = &storage[i];
+		view->mapped = true;
+		view->width = rng_range(240, 1400);
+		view->height = rng_range(160, 1000);
+		view->x = rng_range(-view->width / 4, LAYOUT_W - view->width * 3 / 4);
+		view->y = rng_range(0, LAYOUT_H - view->height / 2);
+		view->stack_seq = (uint64_t)(view_count - i);
+		views[i] = view;
+
+		struct wlr_box box = {
+			.x = view->x - GRAB_PAD,
+			.y = view->y - GRAB_PAD,
+			.width = view->width + GRAB_PAD * 2,
+			.height = view->height + GRAB_PAD * 2,
+		};
+		spatial_index_set(index, FLUX_SPATIAL_FRAMES, view, &box);
+	}
+	for (int i = 0; i < query_count; i++) {
+		points[i * 2] = rng_range(0, LAYOUT_W - 1) + 0.5;
+		points[i * 2 + 1] = rng_range(0, LAYOUT_H - 1) + 0.5;
+	}
+
+	/* Keeps the loops from being optimised away. */
+	volatile uintptr_t sink = 0;
+	uint64_t start = now_nsec();
+	for (int i = 0; i < query_count; i++) {
+		sink += (uintptr_t)linear_at(views, view_count, points[i * 2], points[i * 2 + 1]);
+	}
+	uint64_t linear_nsec = now_nsec() - start;
+
+	start = now_nsec();
+	for (int i = 0; i < query_count; i++) {
+		sink -= (uintptr_t)indexed_at(index, points[i * 2], points[i * 2 + 1]);
+	}
+	uint64_t indexed_nsec = now_nsec() - start;
+
+	int mismatches = 0;
+	for (int i = 0; i < query_count; i++) {
+		if (linear_at(views, view_count, points[i * 2], points[i * 2 + 1]) !=
+				indexed_at(index, points[i * 2], points[i * 2 + 1])) {
+			mismatches++;
+		}
+	}
+
+	/* Topmost view where the pointer is, as focus_view() does on click. */
+	start = now_nsec();
+	for (int i = 0; i < query_count; i++) {
+		struct flux_view *view = indexed_at(index, points[i * 2], points[i * 2 + 1]);
+		if (view) {
+			view->stack_seq = (uint64_t)(view_count + i + 1);
+			spatial_index_restack(index, view);
+		}
+	}
+	uint64_t restack_nsec = now_nsec() - start;
+
+	printf("%5d views: linear %7.1f ns  indexed %7.1f ns  (%5.1fx)  raise %7.1f ns\n",
+		view_count,
+		(double)linear_nsec / query_count,
+		(double)indexed_nsec / query_count,
+		indexed_nsec ? (double)linear_nsec / (double)indexed_nsec : 0.0,
+		(double)restack_nsec / query_count);
+	if (mismatches) {
+		printf("  %d of %d queries disagree\n", mismatches, query_count);
+	}
+
+	spatial_index_destroy(index);
+	free(points);
+	free(views);
+	free(storage);
+	return mismatches ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+	int query_count = argc > 1 ? atoi(argv[1]) : 200000;
+	if (query_count <= 0) {
+		fprintf(stderr, "usage: %s [queries]\n", argv[0]);
+		return 2;
+	}
+
+	static const int view_counts[] = {10, 100, 200, 1000};
+	int status = 0;
+	for (size_t i = 0; i < sizeof(view_counts) / sizeof(view_counts[0]); i++) {
+		status |= run(view_counts[i], query_count);
+	}
+	return status;
+}
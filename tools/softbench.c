@@ -0,0 +1,247 @@
+#include "flux.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/*
+ * Soft compositor microbenchmark: a full repaint of a synthetic 3840x2160
+ * desktop (background, overlapping opaque windows with translucent edges, two
+ * translucent windows, a taskbar; all on screen) cut into 128px tiles, the way
+ * soft_compositor.c flattens and splits a frame. The pixman kernels on one
+ * thread stand in for the pixman renderer; the best kernels then run on 1..N
+ * threads. Every run must match the pixman output bit for bit.
+ *
+ *   softbench [frames] [max_threads]
+ */
+
+#define BENCH_W 3840
+#define BENCH_H 2160
+#define BENCH_TILE 128
+#define BENCH_EDGE 24
+#define BENCH_MAX_THREADS 16
+
+enum bench_op_type {
+	BENCH_FILL,
+	BENCH_COPY,
+	BENCH_BLEND,
+};
+
+struct bench_op {
+	enum bench_op_type type;
+	struct wlr_box box;
+	uint32_t color;
+	const uint32_t *src; // pixel at box.x, box.y
+	size_t src_stride;
+};
+
+struct bench_frame {
+	struct bench_op ops[64];
+	int op_count;
+	uint32_t *dst;
+	const struct soft_kernels *kernels;
+	atomic_int next_tile;
+};
+
+static uint64_t now_nsec(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void add_op(struct bench_frame *frame, enum bench_op_type type, int x, int y,
+		int width, int height, uint32_t color, const uint32_t *window, size_t stride,
+		int wx, int wy) {
+	struct bench_op *op = &frame->ops[frame->op_count++];
+	*op = (struct bench_op){
+		.type = type,
+		.box = { .x = x, .y = y, .width = width, .height = height },
+		.color = color,
+		.src = window ? window + (size_t)(y - wy) * stride + (size_t)(x - wx) : NULL,
+		.src_stride = stride,
+	};
+}
+
+/* Premultiplied ARGB with a translucent border, like a client with shadows. */
+static uint32_t *make_window(int width, int height, uint32_t seed, bool translucent) {
+	uint32_t *pixels = malloc((size_t)width * (size_t)height * 4);
+	if (!pixels) {
+		return NULL;
+	}
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			bool edge = x < BENCH_EDGE || y < BENCH_EDGE ||
+				x >= width - BENCH_EDGE || y >= height - BENCH_EDGE;
+			uint32_t alpha = translucent ? 0xb0 : edge ? (uint32_t)(x * 7 + y * 5) & 0x7f : 0xff;
+			uint32_t r = ((uint32_t)x * 3 + seed) & 0xff;
+			uint32_t g = ((uint32_t)y * 5 + seed * 7) & 0xff;
+			uint32_t b = ((uint32_t)(x ^ y) + seed * 13) & 0xff;
+			pixels[(size_t)y * (size_t)width + (size_t)x] = alpha << 24 |
+				(r * alpha / 255) << 16 | (g * alpha / 255) << 8 | (b * alpha / 255);
+		}
+	}
+	return pixels;
+}
+
+/* Local so the tool links without wlroots. */
+static bool intersect(struct wlr_box *out, const struct wlr_box *a, const struct wlr_box *b) {
+	int x1 = a->x > b->x ? a->x : b->x;
+	int y1 = a->y > b->y ? a->y : b->y;
+	int x2 = a->x + a->width < b->x + b->width ? a->x + a->width : b->x + b->width;
+	int y2 = a->y + a->height < b->y + b->height ? a->y + a->height : b->y + b->height;
+	*out = (struct wlr_box){ .x = x1, .y = y1, .width = x2 - x1, .height = y2 - y1 };
+	return x2 > x1 && y2 > y1;
+}
+
+static void render_tile(struct bench_frame *frame, const struct wlr_box *tile) {
+	const struct soft_kernels *kernels = frame->kernels;
+	for (int i = 0; i < frame->op_count; i++) {
+		const struct bench_op *op = &frame->ops[i];
+		struct wlr_box part;
+		if (!intersect(&part, &op->box, tile)) {
+			continue;
+		}
+		uint32_t *out = frame->dst + (size_t)part.y * BENCH_W + (size_t)part.x;
+		const uint32_t *in = op->src ? op->src +
+			(size_t)(part.y - op->box.y) * op->src_stride + (size_t)(part.x - op->box.x) : NULL;
+		switch (op->type) {
+		case BENCH_FILL:
+			kernels->fill(out, BENCH_W, part.width, part.height, op->color,
+				(op->color >> 24) != 0xff);
+			break;
+		case BENCH_COPY:
+			kernels->copy(out, BENCH_W, in, op->src_stride, part.width, part.height, 0);
+			break;
+		case BENCH_BLEND:
+			kernels->blend(out, BENCH_W, in, op->src_stride, part.width, part.height);
+			break;
+		}
+	}
+}
+
+static void *run_tiles(void *data) {
+	struct bench_frame *frame = data;
+	int columns = (BENCH_W + BENCH_TILE - 1) / BENCH_TILE;
+	int rows = (BENCH_H + BENCH_TILE - 1) / BENCH_TILE;
+	for (;;) {
+		int i = atomic_fetch_add(&frame->next_tile, 1);
+		if (i >= columns * rows) {
+			return NULL;
+		}
+		struct wlr_box tile = {
+			.x = i % columns * BENCH_TILE,
+			.y = i / columns * BENCH_TILE,
+			.width = BENCH_TILE,
+			.height = BENCH_TILE,
+		};
+		if (tile.x + tile.width > BENCH_W) {
+			tile.width = BENCH_W - tile.x;
+		}
+		if (tile.y + tile.height > BENCH_H) {
+			tile.height = BENCH_H - tile.y;
+		}
+		render_tile(frame, &tile);
+	}
+}
+
+/* Returns nanoseconds per frame. */
+static uint64_t run(struct bench_frame *frame, const struct soft_kernels *kernels,
+		int threads, int frames) {
+	frame->kernels = kernels;
+	pthread_t workers[BENCH_MAX_THREADS];
+	uint64_t start = now_nsec();
+	for (int f = 0; f < frames; f++) {
+		atomic_store(&frame->next_tile, 0);
+		int started = 0;
+		for (; started < threads - 1; started++) {
+			if (pthread_create(&workers[started], NULL, run_tiles, frame) != 0) {
+				break;
+			}
+		}
+		run_tiles(frame);
+		for (int i = 0; i < started; i++) {
+			pthread_join(workers[i], NULL);
+		}
+	}
+	return (now_nsec() - start) / (uint64_t)frames;
+}
+
+int main(int argc, char **argv) {
+	int frames = argc > 1 ? atoi(argv[1]) : 30;
+	int max_threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (frames <= 0 || max_threads <= 0) {
+		fprintf(stderr, "usage: %s [frames] [max_threads]\n", argv[0]);
+		return 2;
+	}
+	if (max_threads > BENCH_MAX_THREADS) {
+		max_threads = BENCH_MAX_THREADS;
+	}
+
+	static const struct { int x, y, width, height; bool translucent; } windows[] = {
+		{ 0, 0, 1920, 1080, false },
+		{ 1800, 80, 2000, 1400, false },
+		{ 300, 700, 1700, 1300, false },
+		{ 2200, 1100, 1500, 1000, false },
+		{ 1000, 300, 900, 700, true },
+		{ 2600, 400, 800, 600, true },
+	};
+	struct bench_frame frame = {0};
+	uint32_t *sources[sizeof(windows) / sizeof(windows[0])] = {0};
+	frame.dst = malloc((size_t)BENCH_W * BENCH_H * 4);
+	uint32_t *reference = malloc((size_t)BENCH_W * BENCH_H * 4);
+	if (!frame.dst || !reference) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	add_op(&frame, BENCH_FILL, 0, 0, BENCH_W, BENCH_H, 0xff203040u, NULL, 0, 0, 0);
+	for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+		int x = windows[i].x, y = windows[i].y;
+		int w = windows[i].width, h = windows[i].height;
+		sources[i] = make_window(w, h, (uint32_t)i * 37, windows[i].translucent);
+		if (!sources[i]) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		size_t stride = (size_t)w;
+		if (windows[i].translucent) {
+			add_op(&frame, BENCH_BLEND, x, y, w, h, 0, sources[i], stride, x, y);
+			continue;
+		}
+		/* Opaque interior is copied, the edges blended, as build_buffer splits them. */
+		int e = BENCH_EDGE;
+		add_op(&frame, BENCH_BLEND, x, y, w, e, 0, sources[i], stride, x, y);
+		add_op(&frame, BENCH_BLEND, x, y + h - e, w, e, 0, sources[i], stride, x, y);
+		add_op(&frame, BENCH_BLEND, x, y + e, e, h - 2 * e, 0, sources[i], stride, x, y);
+		add_op(&frame, BENCH_BLEND, x + w - e, y + e, e, h - 2 * e, 0, sources[i], stride, x, y);
+		add_op(&frame, BENCH_COPY, x + e, y + e, w - 2 * e, h - 2 * e, 0, sources[i], stride, x, y);
+	}
+	add_op(&frame, BENCH_FILL, 0, BENCH_H - 40, BENCH_W, 40, 0xe0101010u, NULL, 0, 0, 0);
+
+	const struct soft_kernels *pixman = soft_kernels_pixman();
+	const struct soft_kernels *best = soft_kernels_best();
+	uint64_t base_nsec = run(&frame, pixman, 1, frames);
+	memcpy(reference, frame.dst, (size_t)BENCH_W * BENCH_H * 4);
+	printf("%-16s 1 thread : %7.2f ms/frame  %6.1f fps\n", pixman->name,
+		(double)base_nsec / 1e6, 1e9 / (double)base_nsec);
+
+	int status = 0;
+	for (int threads = 1; threads <= max_threads; threads *= 2) {
+		memset(frame.dst, 0, (size_t)BENCH_W * BENCH_H * 4);
+		uint64_t nsec = run(&frame, best, threads, frames);
+		bool same = memcmp(reference, frame.dst, (size_t)BENCH_W * BENCH_H * 4) == 0;
+		printf("%-16s %d thread%s: %7.2f ms/frame  %6.1f fps  (%4.1fx)%s\n", best->name,
+			threads, threads == 1 ? " " : "s", (double)nsec / 1e6, 1e9 / (double)nsec,
+			(double)base_nsec / (double)nsec, same ? "" : "  MISMATCH");
+		status |= same ? 0 : 1;
+		if (threads < max_threads && threads * 2 > max_threads) {
+			threads = max_threads / 2;
+		}
+	}
+
+	for (size_t i = 0; i < sizeof(windows) / sizeof(windows[0]); i++) {
+		free(sources[i]);
+	}
+	free(reference);
+	free(frame.dst);
+	return status;
+}